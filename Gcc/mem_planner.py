@@ -0,0 +1,335 @@
+#!/usr/bin/env python3
+"""
+Static memory planner for the STM32N6 application.
+
+Reads the linker script, the linker map and ELF symbols of a build, the NPU
+memory pool description and the generated network, then reports:
+  - occupancy of every linker region and NPU memory pool
+  - size, location and estimated bus traffic of the large static buffers
+  - bandwidth pressure of every memory, against its peak throughput
+  - a placement that puts the buffers with the most traffic per byte in
+    AXISRAM, as far as the free AXISRAM allows
+
+With --emit the placement is written to Inc/mem_placement.h, which the
+buffer declarations use. Rebuild afterwards.
+
+Traffic is estimated from the frame rates (--cam-fps, --lcd-hz, --nn-fps)
+and the access pattern of each buffer, see BUFFERS. --traffic takes a JSON
+file with the same layout to override or add buffers.
+
+Usage: make memreport
+       python3 Gcc/mem_planner.py --elf build/Project.elf --map build/Project.map [--emit]
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Large static buffers: how many frames (slots) the buffer holds, and which bus
+# masters write / read one slot at which rate. 'match' is a regex on the
+# demangled symbol name, 'macro' the placement macro in Inc/mem_placement.h
+BUFFERS = {
+    "lcd_bg_buffer": {
+        "match": r"^lcd_bg_buffer$",
+        "macro": "LCD_BG_BUFFER_SECTION",
+        "slots": 3,     # DISPLAY_BUFFER_NB
+        "writes": [["DCMIPP pipe1", "cam_fps"]],
+        "reads": [["LTDC layer 1", "lcd_hz"]],
+    },
+    "lcd_fg_buffer": {
+        "match": r"^lcd_fg_buffer$",
+        "macro": "LCD_FG_BUFFER_SECTION",
+        "slots": 2,
+        "writes": [["CPU", "nn_fps"]],
+        "reads": [["LTDC layer 2", "lcd_hz"]],
+    },
+    "nn_input_buffers": {
+        "match": r"^nn_input_buffers$",
+        "macro": "NN_INPUT_BUFFERS_SECTION",
+        "slots": 2,     # NN_BUFFER_NB
+        "writes": [["DCMIPP pipe2", "cam_fps"]],
+        "reads": [["CPU", "nn_fps"]],
+    },
+    "camera_buffer": {
+        "match": r"^camera_buffer$",
+        "macro": "CAMERA_BUFFER_SECTION",
+        "slots": 1,
+        "writes": [["DCMIPP pipe2", "nn_fps"]],
+        "reads": [["CPU", "nn_fps"]],
+    },
+    "ei_device_ram": {
+        "match": r"get_device\(\)::memory$",
+        "macro": "EI_DEVICE_RAM_SECTION",
+        "slots": 1,     # sample storage, only touched while ingesting
+        "writes": [],
+        "reads": [],
+    },
+}
+
+# memories that can hold application buffers, the rest are left to the NPU
+AXISRAM = "AXISRAM1_2_S"
+PSRAM = "PSRAM"
+PLACEMENT_ATTR = {AXISRAM: "IN_AXISRAM", PSRAM: "IN_PSRAM"}
+
+
+def fmt_size(n):
+    if n >= 1024 * 1024:
+        return "%.2f MB" % (n / (1024.0 * 1024.0))
+    if n >= 1024:
+        return "%.1f KB" % (n / 1024.0)
+    return "%d B" % n
+
+
+def fmt_rate(n):
+    return "%.1f MB/s" % (n / 1e6)
+
+
+def parse_int(text):
+    text = text.strip()
+    mult = 1
+    if text[-1] in "KkMm":
+        mult = 1024 if text[-1] in "Kk" else 1024 * 1024
+        text = text[:-1]
+    return int(text, 0) * mult
+
+
+def parse_ld_regions(path):
+    """MEMORY block of the linker script: name -> (origin, length)"""
+    with open(path) as f:
+        text = f.read()
+    block = re.search(r"MEMORY\s*{(.*?)}", text, re.S)
+    if not block:
+        sys.exit("ERR: no MEMORY block in %s" % path)
+    regions = {}
+    for m in re.finditer(r"(\w+)\s*\([^)]*\)\s*:\s*ORIGIN\s*=\s*(\w+)\s*,\s*LENGTH\s*=\s*(\w+)", block.group(1)):
+        regions[m.group(1)] = (parse_int(m.group(2)), parse_int(m.group(3)))
+    return regions
+
+
+def parse_map_sections(path):
+    """Output sections of a GNU ld map: [(name, addr, size)]"""
+    with open(path) as f:
+        text = f.read()
+    start = text.find("Linker script and memory map")
+    text = text[start:] if start >= 0 else text
+    sections = []
+    for m in re.finditer(r"^(\.[\w.]+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)", text, re.M):
+        size = int(m.group(3), 16)
+        if size:
+            sections.append((m.group(1), int(m.group(2), 16), size))
+    return sections
+
+
+def parse_elf_symbols(path, nm):
+    """Data symbols of the ELF: [(name, addr, size)], demangled"""
+    try:
+        out = subprocess.check_output([nm, "-S", "-C", path], universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit("ERR: failed to run %s (%s), pass --nm" % (nm, e))
+    symbols = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) == 4 and parts[2] in "bBdD":
+            symbols.append((parts[3], int(parts[0], 16), int(parts[1], 16)))
+    return symbols
+
+
+def parse_mpools(path):
+    """NPU memory pools: [{name, fname, offset, size, bytes_per_cycle}]"""
+    with open(path) as f:
+        desc = json.load(f)
+    mag = {"BYTES": 1, "KBYTES": 1024, "MBYTES": 1024 * 1024}
+    pools = []
+    for p in desc["memory"]["mempools"]:
+        pools.append({
+            "name": p["name"],
+            "fname": p["fname"],
+            "offset": int(p["offset"]["value"], 0) * mag[p["offset"]["magnitude"]],
+            "size": int(p["size"]["value"], 0) * mag[p["size"]["magnitude"]],
+            # peak bytes per NPU clock, as the compiler models it
+            "bytes_per_cycle": p["prop"]["byteWidth"] / float(p["prop"]["freqRatio"]),
+        })
+    return pools
+
+
+def parse_network_pools(path):
+    """Pools used by the generated network: {name: used bytes}, from its header comments"""
+    used = {}
+    if not path or not os.path.exists(path):
+        return used
+    with open(path) as f:
+        text = f.read()
+    sizes = {}
+    for m in re.finditer(r"/\* global pool (\d+) is ([\d.]+) (B|KB|MB)", text):
+        mult = {"B": 1, "KB": 1024, "MB": 1024 * 1024}[m.group(3)]
+        sizes[m.group(1)] = int(float(m.group(2)) * mult)
+    for m in re.finditer(r"/\* index=(\d+) .*? name=(\S+) ", text):
+        if m.group(1) in sizes:
+            used[m.group(2)] = sizes[m.group(1)]
+    return used
+
+
+def region_of(addr, regions):
+    for name, (origin, length) in regions.items():
+        if origin <= addr < origin + length:
+            return name
+    return None
+
+
+def bus_throughput(origin, pools, npu_hz):
+    """Peak throughput of the memory at origin, from the pool on the same bus"""
+    for p in pools:
+        if p["offset"] >> 28 == origin >> 28:
+            return p["bytes_per_cycle"] * npu_hz
+    return None
+
+
+def buffer_traffic(buf, rates):
+    slot = buf["size"] / float(buf["slots"])
+    total = 0.0
+    for master, rate in buf["writes"] + buf["reads"]:
+        total += slot * rates[rate]
+    return total
+
+
+def plan(buffers, free_axisram):
+    """Greedy: highest traffic per byte first, into AXISRAM while it fits"""
+    placement = {}
+    for buf in sorted(buffers, key=lambda b: b["traffic"] / max(b["size"], 1), reverse=True):
+        if buf["traffic"] > 0 and buf["size"] <= free_axisram:
+            placement[buf["key"]] = AXISRAM
+            free_axisram -= buf["size"]
+        else:
+            placement[buf["key"]] = PSRAM
+    return placement
+
+
+def emit_header(path, specs, placement):
+    lines = [
+        "/* Generated by Gcc/mem_planner.py --emit, rerun it after changing buffer sizes or frame rates.",
+        " * Buffers placed IN_PSRAM are in a NOLOAD section and not zero initialised. */",
+        "",
+        "#ifndef MEM_PLACEMENT_H",
+        "#define MEM_PLACEMENT_H",
+        "",
+        "#include \"utils.h\"",
+        "",
+    ]
+    # buffers missing from the build still need their macro, they go to PSRAM
+    for key, spec in sorted(specs.items(), key=lambda kv: kv[1]["macro"]):
+        lines.append("#define %-26s %s" % (spec["macro"], PLACEMENT_ATTR[placement.get(key, PSRAM)]))
+    lines += ["", "#endif", ""]
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report memory occupancy and bus pressure, propose a buffer placement")
+    parser.add_argument("--ld", default=os.path.join(ROOT, "Gcc", "STM32N657xx.ld"))
+    parser.add_argument("--map", default=os.path.join(ROOT, "build", "Project.map"))
+    parser.add_argument("--elf", default=os.path.join(ROOT, "build", "Project.elf"))
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    parser.add_argument("--mpool", default=os.path.join(ROOT, "Model", "my_mpools", "stm32n6-app2.mpool"))
+    parser.add_argument("--network", default=os.path.join(ROOT, "Model", "network.c"))
+    parser.add_argument("--traffic", help="JSON file overriding or adding to the buffer access patterns")
+    parser.add_argument("--cam-fps", type=float, default=30.0)
+    parser.add_argument("--lcd-hz", type=float, default=60.0)
+    parser.add_argument("--nn-fps", type=float, default=30.0)
+    parser.add_argument("--npu-mhz", type=float, default=1000.0)
+    parser.add_argument("--emit", nargs="?", const=os.path.join(ROOT, "Inc", "mem_placement.h"),
+                        help="write the proposed placement (default Inc/mem_placement.h)")
+    args = parser.parse_args()
+
+    rates = {"cam_fps": args.cam_fps, "lcd_hz": args.lcd_hz, "nn_fps": args.nn_fps}
+    npu_hz = args.npu_mhz * 1e6
+
+    specs = dict(BUFFERS)
+    if args.traffic:
+        with open(args.traffic) as f:
+            specs.update(json.load(f))
+
+    regions = parse_ld_regions(args.ld)
+    sections = parse_map_sections(args.map)
+    symbols = parse_elf_symbols(args.elf, args.nm)
+    pools = parse_mpools(args.mpool)
+    pool_used = parse_network_pools(args.network)
+
+    # linker regions
+    used = dict((name, 0) for name in regions)
+    for name, addr, size in sections:
+        region = region_of(addr, regions)
+        if region:
+            used[region] += size
+
+    # buffers
+    buffers = []
+    for key, spec in specs.items():
+        found = [s for s in symbols if re.search(spec["match"], s[0])]
+        if not found:
+            print("WARN: buffer %s not found in %s" % (key, args.elf))
+            continue
+        name, addr, size = found[0]
+        buf = dict(spec, key=key, symbol=name, addr=addr, size=size, region=region_of(addr, regions))
+        buf["traffic"] = buffer_traffic(buf, rates)
+        buffers.append(buf)
+
+    print("Linker regions")
+    print("  %-14s %-12s %12s %12s %6s" % ("region", "origin", "size", "used", "use"))
+    for name, (origin, length) in regions.items():
+        print("  %-14s 0x%08x %12s %12s %5.1f%%" % (name, origin, fmt_size(length), fmt_size(used[name]),
+                                                    100.0 * used[name] / length))
+
+    print("\nNPU memory pools (%s)" % os.path.basename(args.mpool))
+    print("  %-14s %-12s %12s %12s %6s" % ("pool", "offset", "size", "used", "use"))
+    for p in pools:
+        u = pool_used.get(p["name"], 0)
+        print("  %-14s 0x%08x %12s %12s %5.1f%%" % (p["name"], p["offset"], fmt_size(p["size"]), fmt_size(u),
+                                                    100.0 * u / p["size"]))
+    for k, v in pool_used.items():
+        if "_" in k:
+            print("  %-14s %s used across %s" % ("(virtual)", fmt_size(v), k.replace("_", " ")))
+
+    print("\nBuffers (cam %.0f fps, lcd %.0f Hz, nn %.0f fps)" % (args.cam_fps, args.lcd_hz, args.nn_fps))
+    print("  %-18s %-14s %12s %12s %14s" % ("buffer", "region", "size", "traffic", "traffic/byte"))
+    for buf in sorted(buffers, key=lambda b: b["traffic"], reverse=True):
+        print("  %-18s %-14s %12s %12s %13.1f/s" % (buf["key"], buf["region"], fmt_size(buf["size"]),
+                                                    fmt_rate(buf["traffic"]), buf["traffic"] / max(buf["size"], 1)))
+
+    # bandwidth pressure of the memories holding application buffers, the NPU traffic
+    # on its own pools isn't modelled (AXISRAM3-6 are separate banks)
+    print("\nBandwidth pressure")
+    for name, (origin, length) in regions.items():
+        peak = bus_throughput(origin, pools, npu_hz)
+        traffic = sum(b["traffic"] for b in buffers if b["region"] == name)
+        if peak:
+            print("  %-14s %12s of %12s peak, %5.1f%%" % (name, fmt_rate(traffic), fmt_rate(peak), 100.0 * traffic / peak))
+        else:
+            print("  %-14s %12s, peak unknown" % (name, fmt_rate(traffic)))
+
+    # every candidate is movable, so the budget is the AXISRAM left once they're all out
+    candidates = sum(b["size"] for b in buffers if b["region"] == AXISRAM)
+    free_axisram = regions[AXISRAM][1] - used[AXISRAM] + candidates
+    placement = plan(buffers, free_axisram)
+
+    print("\nProposed placement (%s of %s free for buffers)" % (fmt_size(free_axisram), AXISRAM))
+    moves = 0
+    for buf in buffers:
+        target = placement[buf["key"]]
+        mark = "" if target == buf["region"] else "  <- move from %s" % buf["region"]
+        moves += 1 if mark else 0
+        print("  %-26s %s%s" % (buf["macro"], PLACEMENT_ATTR[target], mark))
+    if moves == 0:
+        print("  current placement is already the proposed one")
+
+    if args.emit:
+        emit_header(args.emit, specs, placement)
+        print("\nWrote %s, rebuild to apply" % os.path.relpath(args.emit, ROOT))
+
+
+if __name__ == "__main__":
+    main()
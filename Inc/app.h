@@ -18,6 +18,13 @@
 #ifndef APP_H
 #define APP_H
 
+#include <stdint.h>
+
 void app_run(void);
+void app_nn_pipe_start(void);
+void app_nn_pipe_stop(void);
+uint8_t *app_nn_pipe_get_frame(void);
+void app_nn_pipe_snapshot(uint8_t *dst);
+void app_nn_pipe_get_frame_info(uint32_t *timestamp_ms, uint32_t *dropped);
 
 #endif
\ No newline at end of file
@@ -78,5 +78,7 @@
 #define NN_HEIGHT 640
 #define NN_FORMAT DCMIPP_PIXEL_PACKER_FORMAT_RGB888_YUV444_1
 #define NN_BPP 3
+/* Number of nn input buffers used in continuous capture, 2 (double) or 3 (triple buffering) */
+#define NN_BUFFER_NB 2
 
 #endif
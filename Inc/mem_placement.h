@@ -0,0 +1,15 @@
+/* Generated by Gcc/mem_planner.py --emit, rerun it after changing buffer sizes or frame rates.
+ * Buffers placed IN_PSRAM are in a NOLOAD section and not zero initialised. */
+
+#ifndef MEM_PLACEMENT_H
+#define MEM_PLACEMENT_H
+
+#include "utils.h"
+
+#define CAMERA_BUFFER_SECTION      IN_PSRAM
+#define EI_DEVICE_RAM_SECTION      IN_AXISRAM
+#define LCD_BG_BUFFER_SECTION      IN_PSRAM
+#define LCD_FG_BUFFER_SECTION      IN_PSRAM
+#define NN_INPUT_BUFFERS_SECTION   IN_PSRAM
+
+#endif
@@ -20,6 +20,7 @@
 
 #define ALIGN_32 __attribute__ ((aligned (32)))
 #define IN_PSRAM __attribute__ ((section (".psram_bss")))
+#define IN_AXISRAM /* default .bss, AXISRAM1_2_S */
 #define UNCACHED __attribute__ ((section (".uncached_bss")))
 #define WEAK __weak
 
@@ -73,3 +73,34 @@ void LL_ATON_RT_Main(NN_Instance_TypeDef *network_instance)
 
   /*** End of user de-initialization code ***/
 }
+
+/*** Persistent Session ***/
+
+/**
+ * @brief Synchronously execute a single inference of a network instance, without re-initializing the runtime
+ * @param network_instance pointer to the network instance to execute
+ *
+ * @note  The runtime must have been initialized by means of `LL_ATON_RT_RuntimeInit()` and the network instance by
+ *        means of `LL_ATON_RT_Init_Network()`, both once. The network instance is reset by means of
+ *        `LL_ATON_RT_Reset_Network()` before each inference, which only re-sets the execution state and does neither
+ *        re-initialize the runtime nor re-relocate the network
+ */
+void LL_ATON_RT_Session_Run(NN_Instance_TypeDef *network_instance)
+{
+  LL_ATON_RT_RetValues_t ll_aton_rt_ret;
+
+  LL_ATON_ASSERT(network_instance != NULL);
+  LL_ATON_RT_Reset_Network(network_instance); // Get ready for a new inference
+
+  do
+  {
+    /* Execute first/next step of Cube.AI/ATON runtime */
+    ll_aton_rt_ret = LL_ATON_RT_RunEpochBlock(network_instance);
+
+    /* Wait for next event */
+    if (ll_aton_rt_ret == LL_ATON_RT_WFE)
+    {
+      LL_ATON_OSAL_WFE();
+    }
+  } while (ll_aton_rt_ret != LL_ATON_RT_DONE);
+}
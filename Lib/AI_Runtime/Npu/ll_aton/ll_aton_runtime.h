@@ -294,6 +294,13 @@ extern "C"
    */
   void LL_ATON_RT_Main(NN_Instance_TypeDef *network_instance);
 
+  /**
+   * @brief Reset a network instance and synchronously execute one inference, the runtime and the network instance
+   *        must have been initialized once before (`LL_ATON_RT_RuntimeInit()`, `LL_ATON_RT_Init_Network()`)
+   * @param network_instance pointer to the network instance to execute
+   */
+  void LL_ATON_RT_Session_Run(NN_Instance_TypeDef *network_instance);
+
   /** @brief Dumps status of all DMAs. Used for debugging purposes
    */
   void dump_dma_state(void);
@@ -1205,6 +1205,15 @@ static int32_t CMW_CAMERA_SetPipe(DCMIPP_HandleTypeDef *hdcmipp, uint32_t pipe,
       return CMW_ERROR_COMPONENT_FAILURE;
     }
   }
+  else
+  {
+    /* Reconfiguration: drop the crop of the previous configuration */
+    ret = HAL_DCMIPP_PIPE_DisableCrop(hdcmipp, pipe);
+    if (ret != HAL_OK)
+    {
+      return CMW_ERROR_COMPONENT_FAILURE;
+    }
+  }
 
   ret = HAL_DCMIPP_PIPE_SetDecimationConfig(hdcmipp, pipe, &dec_conf);
   if (ret != HAL_OK)
@@ -1239,6 +1248,14 @@ static int32_t CMW_CAMERA_SetPipe(DCMIPP_HandleTypeDef *hdcmipp, uint32_t pipe,
       return CMW_ERROR_COMPONENT_FAILURE;
     }
   }
+  else
+  {
+    ret = HAL_DCMIPP_PIPE_DisableRedBlueSwap(hdcmipp, pipe);
+    if (ret != HAL_OK)
+    {
+      return CMW_ERROR_COMPONENT_FAILURE;
+    }
+  }
 
   if (p_conf->enable_gamma_conversion)
   {
@@ -1259,9 +1276,36 @@ static int32_t CMW_CAMERA_SetPipe(DCMIPP_HandleTypeDef *hdcmipp, uint32_t pipe,
   }
 
   pipe_conf.FrameRate = DCMIPP_FRAME_RATE_ALL;
-  pipe_conf.PixelPipePitch = p_conf->output_width * p_conf->output_bpp;
+  /* Pixel pipe pitch must be a multiple of 16 bytes, narrower rows are padded */
+  pipe_conf.PixelPipePitch = (p_conf->output_width * p_conf->output_bpp + 15) & ~15U;
   pipe_conf.PixelPackerFormat = p_conf->output_format;
-  ret = HAL_DCMIPP_PIPE_SetConfig(hdcmipp, pipe, &pipe_conf);
+
+  /* HAL_DCMIPP_PIPE_SetConfig only accepts a pipe that was never configured, later calls
+   * (pipe stopped, e.g. between snapshots) update the pitch and format registers directly */
+  if ((hdcmipp->PipeState[pipe] == HAL_DCMIPP_PIPE_STATE_RESET) ||
+      (hdcmipp->PipeState[pipe] == HAL_DCMIPP_PIPE_STATE_ERROR))
+  {
+    ret = HAL_DCMIPP_PIPE_SetConfig(hdcmipp, pipe, &pipe_conf);
+    if (ret != HAL_OK)
+    {
+      return CMW_ERROR_COMPONENT_FAILURE;
+    }
+    return HAL_OK;
+  }
+
+  ret = HAL_DCMIPP_PIPE_SetPitch(hdcmipp, pipe, pipe_conf.PixelPipePitch);
+  if (ret != HAL_OK)
+  {
+    return CMW_ERROR_COMPONENT_FAILURE;
+  }
+
+  ret = HAL_DCMIPP_PIPE_SetPixelPackerFormat(hdcmipp, pipe, pipe_conf.PixelPackerFormat);
+  if (ret != HAL_OK)
+  {
+    return CMW_ERROR_COMPONENT_FAILURE;
+  }
+
+  ret = HAL_DCMIPP_PIPE_SetFrameRate(hdcmipp, pipe, pipe_conf.FrameRate);
   if (ret != HAL_OK)
   {
     return CMW_ERROR_COMPONENT_FAILURE;
@@ -31,6 +31,7 @@
 #include "stm32n6xx_hal.h"
 #include "tx_api.h"
 #include "utils.h"
+#include "mem_placement.h"
 
 extern void ei_main(void);
 extern void ei_init(void);
@@ -45,7 +46,7 @@ extern int32_t update_score_buffer(postprocess_outBuffer_t *pOutput, int32_t max
 } while (0)
 
 #define NUMBER_COLORS 10
-#define BQUEUE_MAX_BUFFERS 2
+#define BQUEUE_MAX_BUFFERS 3
 
 #define DISPLAY_BUFFER_NB (DISPLAY_DELAY + 2)
 
@@ -62,8 +63,10 @@ typedef struct {
   TX_SEMAPHORE ready;
   int buffer_nb;
   uint8_t *buffers[BQUEUE_MAX_BUFFERS];
+  uint32_t timestamps[BQUEUE_MAX_BUFFERS];
   int free_idx;
   int ready_idx;
+  int timestamp_idx;
 } bqueue_t;
 
 typedef struct {
@@ -107,16 +110,23 @@ static const uint32_t colors[NUMBER_COLORS] = {
     UTIL_LCD_COLOR_ORANGE
 };
 /* Lcd Background Buffer */
-static uint8_t lcd_bg_buffer[DISPLAY_BUFFER_NB][LCD_BG_WIDTH * LCD_BG_HEIGHT * 2] ALIGN_32 IN_PSRAM;
+static uint8_t lcd_bg_buffer[DISPLAY_BUFFER_NB][LCD_BG_WIDTH * LCD_BG_HEIGHT * 2] ALIGN_32 LCD_BG_BUFFER_SECTION;
 static int lcd_bg_buffer_disp_idx = 1;
 static int lcd_bg_buffer_capt_idx = 0;
 /* Lcd Foreground Buffer */
-static uint8_t lcd_fg_buffer[2][LCD_FG_WIDTH * LCD_FG_HEIGHT* 2] ALIGN_32 IN_PSRAM;
+static uint8_t lcd_fg_buffer[2][LCD_FG_WIDTH * LCD_FG_HEIGHT* 2] ALIGN_32 LCD_FG_BUFFER_SECTION;
 static int lcd_fg_buffer_rd_idx;
 static display_t disp;
-
- /* new frame flag */
-volatile int32_t cameraFrameReceived;
+/* Nn input buffers, rotated by PIPE2 in continuous mode */
+static uint8_t nn_input_buffers[NN_BUFFER_NB][NN_WIDTH * NN_HEIGHT * NN_BPP] ALIGN_32 NN_INPUT_BUFFERS_SECTION;
+static bqueue_t nn_input_queue;
+static volatile int nn_pipe_continuous;
+static uint8_t *nn_input_held;
+/* Nn frame completion: snapshot signal, capture time (ms) of last delivered frame, dropped frames */
+static TX_SEMAPHORE nn_snapshot_sem;
+static volatile uint32_t nn_snapshot_ts;
+static uint32_t nn_frame_ts;
+static volatile uint32_t nn_frame_dropped;
 
  /* threads */
   /* nn thread */
@@ -139,6 +149,102 @@ static int is_cache_enable()
 #endif
 }
 
+static int bqueue_init(bqueue_t *bq, int buffer_nb, uint8_t **buffers)
+{
+  int ret;
+  int i;
+
+  if (buffer_nb > BQUEUE_MAX_BUFFERS)
+    return -1;
+
+  ret = tx_semaphore_create(&bq->free, NULL, buffer_nb);
+  if (ret)
+    goto free_sem_error;
+  ret = tx_semaphore_create(&bq->ready, NULL, 0);
+  if (ret)
+    goto ready_sem_error;
+
+  bq->buffer_nb = buffer_nb;
+  for (i = 0; i < buffer_nb; i++) {
+    assert(buffers[i]);
+    bq->buffers[i] = buffers[i];
+  }
+  bq->free_idx = 0;
+  bq->ready_idx = 0;
+  bq->timestamp_idx = 0;
+
+  return 0;
+
+ready_sem_error:
+  tx_semaphore_delete(&bq->free);
+free_sem_error:
+  return -1;
+}
+
+static void bqueue_deinit(bqueue_t *bq)
+{
+  tx_semaphore_delete(&bq->ready);
+  tx_semaphore_delete(&bq->free);
+}
+
+static uint8_t *bqueue_get_free(bqueue_t *bq, int is_blocking)
+{
+  uint8_t *res;
+  int ret;
+
+  ret = tx_semaphore_get(&bq->free, is_blocking ? TX_WAIT_FOREVER : TX_NO_WAIT);
+  if (ret == TX_NO_INSTANCE)
+    return NULL;
+  assert(ret == 0);
+
+  res = bq->buffers[bq->free_idx];
+  bq->free_idx = (bq->free_idx + 1) % bq->buffer_nb;
+
+  return res;
+}
+
+static void bqueue_put_free(bqueue_t *bq)
+{
+  int ret;
+
+  ret = tx_semaphore_put(&bq->free);
+  assert(ret == 0);
+}
+
+static uint8_t *bqueue_get_ready(bqueue_t *bq)
+{
+  uint8_t *res;
+  int ret;
+
+  ret = tx_semaphore_get(&bq->ready, TX_WAIT_FOREVER);
+  assert(ret == 0);
+
+  res = bq->buffers[bq->ready_idx];
+  bq->ready_idx = (bq->ready_idx + 1) % bq->buffer_nb;
+
+  return res;
+}
+
+static void bqueue_put_ready(bqueue_t *bq)
+{
+  int ret;
+
+  ret = tx_semaphore_put(&bq->ready);
+  assert(ret == 0);
+}
+
+/* Timestamps follow the ready order: stamp the buffer about to be made ready / just taken */
+static void bqueue_set_ready_timestamp(bqueue_t *bq, uint32_t ts)
+{
+  bq->timestamps[bq->timestamp_idx] = ts;
+  bq->timestamp_idx = (bq->timestamp_idx + 1) % bq->buffer_nb;
+}
+
+static uint32_t bqueue_get_ready_timestamp(bqueue_t *bq)
+{
+  return bq->timestamps[(bq->ready_idx + bq->buffer_nb - 1) % bq->buffer_nb];
+}
+
 static void app_main_pipe_frame_event()
 {
   int next_disp_idx = (lcd_bg_buffer_disp_idx + 1) % DISPLAY_BUFFER_NB;
@@ -157,6 +263,34 @@ static void app_main_pipe_frame_event()
   lcd_bg_buffer_capt_idx = next_capt_idx;
 }
 
+static void app_nn_pipe_frame_event()
+{
+  uint8_t *next_buffer;
+  int ret;
+
+  /* No free buffer: DCMIPP overwrites the current one and the frame is dropped */
+  next_buffer = bqueue_get_free(&nn_input_queue, 0);
+  if (next_buffer) {
+    ret = HAL_DCMIPP_PIPE_SetMemoryAddress(CMW_CAMERA_GetDCMIPPHandle(), DCMIPP_PIPE2,
+                                           DCMIPP_MEMORY_ADDRESS_0, (uint32_t) next_buffer);
+    assert(ret == HAL_OK);
+    bqueue_set_ready_timestamp(&nn_input_queue, HAL_GetTick());
+    /* minimize time where buffer is not own by anyone */
+    bqueue_put_ready(&nn_input_queue);
+  } else {
+    nn_frame_dropped++;
+  }
+}
+
+static void app_nn_pipe_snapshot_event()
+{
+  int ret;
+
+  nn_snapshot_ts = HAL_GetTick();
+  ret = tx_semaphore_ceiling_put(&nn_snapshot_sem, 1);
+  assert(ret == 0);
+}
+
 static void app_main_pipe_vsync_event()
 {
   int ret;
@@ -261,7 +395,7 @@ static void nn_thread_ei_fct(ULONG arg)
 
   while (1)
   {
-    HAL_Delay(5);
+    /* blocks on the UART while no inference is running */
     ei_main();
 
     /* update display stats and detection info */
@@ -360,6 +494,8 @@ void app_run()
   assert(ret == 0);
   ret= tx_mutex_create(&disp.lock, NULL, TX_INHERIT);
   assert(ret == 0);
+  ret = tx_semaphore_create(&nn_snapshot_sem, NULL, 0);
+  assert(ret == 0);
 
   /* Start LCD Display camera pipe stream */
   CAM_DisplayPipe_Start(lcd_bg_buffer[0], CAMERA_MODE_CONTINUOUS);
@@ -377,12 +513,98 @@ void app_run()
   assert(ret == TX_SUCCESS);
 }
 
+/* Start PIPE2 in continuous mode, frames are rotated through NN_BUFFER_NB buffers */
+void app_nn_pipe_start(void)
+{
+  uint8_t *buffers[NN_BUFFER_NB];
+  uint8_t *capture_buffer;
+  int ret;
+  int i;
+
+  if (nn_pipe_continuous)
+    return;
+
+  for (i = 0; i < NN_BUFFER_NB; i++)
+    buffers[i] = nn_input_buffers[i];
+  ret = bqueue_init(&nn_input_queue, NN_BUFFER_NB, buffers);
+  assert(ret == 0);
+
+  capture_buffer = bqueue_get_free(&nn_input_queue, 0);
+  assert(capture_buffer);
+  nn_input_held = NULL;
+  nn_pipe_continuous = 1;
+
+  CAM_NNPipe_Start(capture_buffer, CAMERA_MODE_CONTINUOUS);
+}
+
+void app_nn_pipe_stop(void)
+{
+  int ret;
+
+  if (!nn_pipe_continuous)
+    return;
+
+  ret = HAL_DCMIPP_CSI_PIPE_Stop(CMW_CAMERA_GetDCMIPPHandle(), DCMIPP_PIPE2, DCMIPP_VIRTUAL_CHANNEL0);
+  assert(ret == HAL_OK);
+  nn_pipe_continuous = 0;
+  nn_input_held = NULL;
+
+  bqueue_deinit(&nn_input_queue);
+}
+
+/* Hand back the previously returned buffer and wait for the next captured one */
+uint8_t *app_nn_pipe_get_frame(void)
+{
+  const uint32_t size = NN_WIDTH * NN_HEIGHT * NN_BPP;
+
+  assert(nn_pipe_continuous);
+
+  if (nn_input_held) {
+    /* drop lines written by the cpu (in place crop), DCMIPP will overwrite this buffer */
+    CACHE_OP(SCB_InvalidateDCache_by_Addr(nn_input_held, size));
+    bqueue_put_free(&nn_input_queue);
+  }
+
+  nn_input_held = bqueue_get_ready(&nn_input_queue);
+  nn_frame_ts = bqueue_get_ready_timestamp(&nn_input_queue);
+  CACHE_OP(SCB_InvalidateDCache_by_Addr(nn_input_held, size));
+
+  return nn_input_held;
+}
+
+/* Capture a single PIPE2 frame into dst, the calling thread sleeps until it has landed */
+void app_nn_pipe_snapshot(uint8_t *dst)
+{
+  int ret;
+
+  assert(!nn_pipe_continuous);
+
+  /* discard a completion left over from an aborted capture */
+  tx_semaphore_get(&nn_snapshot_sem, TX_NO_WAIT);
+
+  CAM_NNPipe_Start(dst, CAMERA_MODE_SNAPSHOT);
+
+  ret = tx_semaphore_get(&nn_snapshot_sem, TX_WAIT_FOREVER);
+  assert(ret == 0);
+  nn_frame_ts = nn_snapshot_ts;
+}
+
+/* Capture time (HAL tick, ms) of the last frame handed to the nn thread and number of frames dropped so far */
+void app_nn_pipe_get_frame_info(uint32_t *timestamp_ms, uint32_t *dropped)
+{
+  *timestamp_ms = nn_frame_ts;
+  *dropped = nn_frame_dropped;
+}
+
 int CMW_CAMERA_PIPE_FrameEventCallback(uint32_t pipe)
 {
   if (pipe == DCMIPP_PIPE1)
     app_main_pipe_frame_event();
   else if (pipe == DCMIPP_PIPE2) {
-    cameraFrameReceived++;
+    if (nn_pipe_continuous)
+      app_nn_pipe_frame_event();
+    else
+      app_nn_pipe_snapshot_event();
   }
 
   return HAL_OK;
@@ -16,10 +16,13 @@
  ******************************************************************************
  */
 #include <assert.h>
+#include <string.h>
 #include "cmw_camera.h"
+#include "app.h"
 #include "app_cam.h"
 #include "app_config.h"
 #include "utils.h"
+#include "mem_placement.h"
 
 static int CAM_GetDecimationRatio(float ratio)
 {
@@ -76,6 +79,53 @@ static void CAM_InitNnManualConf(CMW_Manual_Configuration_t *conf)
   CAM_InitDecimationConfig(conf);
 }
 
+/* Largest area with the aspect ratio of the output, centred in the display crop (no stretching) */
+static void CAM_InitNnCropConfig(CMW_Manual_Configuration_t *conf, int width, int height)
+{
+  CMW_Manual_Crop_t *crop = &conf->crop;
+  CMW_Manual_Crop_t display;
+  float ratio;
+
+  CAM_InitCropConfig(conf);
+  display = *crop;
+  ratio = MIN((float)display.width / width, (float)display.height / height);
+
+  crop->width = (uint32_t) MIN(width * ratio, display.width);
+  crop->height = (uint32_t) MIN(height * ratio, display.height);
+  crop->offset_x = display.offset_x + (display.width - crop->width) / 2;
+  crop->offset_y = display.offset_y + (display.height - crop->height) / 2;
+}
+
+/* PIPE2 pitch must be a multiple of 16 bytes, narrower rows are padded */
+static uint32_t CAM_GetNnPitch(int width)
+{
+  return (width * NN_BPP + 15) & ~15U;
+}
+
+/* Crop, decimation and downsize producing width x height, -1 if the pipe can't output it */
+static int CAM_InitEiNnManualConf(CMW_Manual_Configuration_t *conf, int width, int height)
+{
+  float ratio_x;
+  float ratio_y;
+
+  if (width <= 0 || height <= 0 || CAM_GetNnPitch(width) * height > NN_WIDTH * NN_HEIGHT * NN_BPP)
+    return -1;
+
+  conf->downsize.width = width;
+  conf->downsize.height = height;
+  CAM_InitNnCropConfig(conf, width, height);
+
+  /* only scaling down, by up to 64: decimation takes up to 8, downsize less than 8 of the rest */
+  ratio_x = (float)conf->crop.width / width;
+  ratio_y = (float)conf->crop.height / height;
+  if (ratio_x < 1 || ratio_y < 1 || ratio_x > 64 || ratio_y > 64)
+    return -1;
+
+  CAM_InitDecimationConfig(conf);
+
+  return 0;
+}
+
 static void DCMIPP_PipeInitDisplay()
 {
   DCMIPP_Conf_t dcmipp_conf;
@@ -112,38 +162,161 @@ static void DCMIPP_PipeInitNn()
   assert(ret == HAL_OK);
 }
 
-void CAM_ei_PipeInitNn(int width, int height)
+static int nn_ei_width = NN_WIDTH;
+static int nn_ei_height = NN_HEIGHT;
+/* Full field of view crop at the current output size, region of interest crops are taken within it */
+static CMW_Manual_Crop_t nn_ei_fov;
+
+static int CAM_ei_PipeSetManualConf(CMW_Manual_Configuration_t *conf, int width, int height)
 {
   DCMIPP_Conf_t dcmipp_conf;
   int ret;
 
-  dcmipp_conf.output_width = width,
-  dcmipp_conf.output_height = height,
-  dcmipp_conf.output_format = NN_FORMAT,
-  dcmipp_conf.output_bpp = NN_BPP,
+  dcmipp_conf.output_width = width;
+  dcmipp_conf.output_height = height;
+  dcmipp_conf.output_format = NN_FORMAT;
+  dcmipp_conf.output_bpp = NN_BPP;
   dcmipp_conf.mode = CAM_Aspect_ratio_manual;
   dcmipp_conf.enable_swap = 1;
   dcmipp_conf.enable_gamma_conversion = 0;
-  CAM_InitNnManualConf(&dcmipp_conf.manual_conf);
+  dcmipp_conf.manual_conf = *conf;
   ret = CMW_CAMERA_SetPipeConfig(DCMIPP_PIPE2, &dcmipp_conf);
-  assert(ret == HAL_OK);
+
+  return ret == HAL_OK ? 0 : -1;
+}
+
+/* Whether PIPE2 can output width x height RGB888 frames */
+int CAM_ei_PipeIsSupported(int width, int height)
+{
+  CMW_Manual_Configuration_t conf;
+
+  return CAM_InitEiNnManualConf(&conf, width, height) == 0;
+}
+
+/* Reconfigure PIPE2 to output width x height frames of the full field of view, PIPE2 must not be capturing */
+int CAM_ei_PipeInitNn(int width, int height)
+{
+  CMW_Manual_Configuration_t conf;
+
+  if (CAM_InitEiNnManualConf(&conf, width, height))
+    return -1;
+
+  if (CAM_ei_PipeSetManualConf(&conf, width, height))
+    return -1;
+
+  nn_ei_width = width;
+  nn_ei_height = height;
+  nn_ei_fov = conf.crop;
+
+  return 0;
+}
+
+/*
+ * Move the PIPE2 crop to a region of interest, given as a fraction (0 to 1) of the full field
+ * of view. The region is grown to the output aspect ratio and to at least the output size in
+ * sensor pixels (native resolution, the downsize can't upscale), then moved inside the field
+ * of view. The region actually captured is written back. PIPE2 must not be capturing.
+ */
+int CAM_ei_PipeSetRoi(float *x, float *y, float *width, float *height)
+{
+  const CMW_Manual_Crop_t *fov = &nn_ei_fov;
+  CMW_Manual_Configuration_t conf;
+  CMW_Manual_Crop_t *crop = &conf.crop;
+  float crop_width = MAX(*width * fov->width, nn_ei_width);
+  float crop_height = MAX(*height * fov->height, nn_ei_height);
+  float scale = MAX(crop_width / nn_ei_width, crop_height / nn_ei_height);
+  float center_x = fov->offset_x + (*x + *width / 2) * fov->width;
+  float center_y = fov->offset_y + (*y + *height / 2) * fov->height;
+  float offset_x;
+  float offset_y;
+
+  crop->width = (uint32_t) MIN(nn_ei_width * scale, fov->width);
+  crop->height = (uint32_t) MIN(nn_ei_height * scale, fov->height);
+  offset_x = MIN(MAX(center_x - crop->width / 2.0f, fov->offset_x), fov->offset_x + fov->width - crop->width);
+  offset_y = MIN(MAX(center_y - crop->height / 2.0f, fov->offset_y), fov->offset_y + fov->height - crop->height);
+  crop->offset_x = (uint32_t) offset_x;
+  crop->offset_y = (uint32_t) offset_y;
+  conf.downsize.width = nn_ei_width;
+  conf.downsize.height = nn_ei_height;
+  CAM_InitDecimationConfig(&conf);
+
+  if (CAM_ei_PipeSetManualConf(&conf, nn_ei_width, nn_ei_height))
+    return -1;
+
+  *x = (float)(crop->offset_x - fov->offset_x) / fov->width;
+  *y = (float)(crop->offset_y - fov->offset_y) / fov->height;
+  *width = (float)crop->width / fov->width;
+  *height = (float)crop->height / fov->height;
+
+  return 0;
+}
+
+/* Drop the row padding of a frame captured with a pitch wider than its rows */
+void CAM_ei_PackFrame(uint8_t *frame)
+{
+  const uint32_t pitch = CAM_GetNnPitch(nn_ei_width);
+  const uint32_t row_bytes = nn_ei_width * NN_BPP;
+  int y;
+
+  if (pitch == row_bytes)
+    return;
+
+  for (y = 1; y < nn_ei_height; y++)
+    memmove(frame + y * row_bytes, frame + y * pitch, row_bytes);
+
+  /* no dirty lines left to be evicted over the next capture */
+#ifdef USE_DCACHE
+  SCB_CleanDCache_by_Addr(frame, row_bytes * nn_ei_height);
+#endif
 }
 
-static uint8_t camera_buffer[NN_WIDTH * NN_HEIGHT * NN_BPP + 1024] ALIGN_32 IN_PSRAM;
+static uint8_t camera_buffer[NN_WIDTH * NN_HEIGHT * NN_BPP + 1024] ALIGN_32 CAMERA_BUFFER_SECTION;
 uint8_t *CAM_ei_capture_frame(void)
 {
-    extern volatile int cameraFrameReceived;
     CAM_IspUpdate();
 
-    /* Start NN camera single capture Snapshot */
-    CAM_NNPipe_Start((uint8_t *)camera_buffer, CAMERA_MODE_SNAPSHOT);
+    /* NN camera single capture Snapshot */
+    app_nn_pipe_snapshot((uint8_t *)camera_buffer);
 
-    while (cameraFrameReceived == 0) {};
-    cameraFrameReceived = 0;
+#ifdef USE_DCACHE
+    SCB_InvalidateDCache_by_Addr(camera_buffer, CAM_GetNnPitch(nn_ei_width) * nn_ei_height);
+#endif
+    CAM_ei_PackFrame(camera_buffer);
 
     return camera_buffer;
 }
 
+/* Capture a single frame straight into dst (e.g. the NPU input buffer) instead of camera_buffer */
+uint8_t *CAM_ei_capture_frame_to(uint8_t *dst, uint32_t size)
+{
+    const uint32_t padded_size = CAM_GetNnPitch(nn_ei_width) * nn_ei_height;
+    const uint32_t row_bytes = nn_ei_width * NN_BPP;
+
+    /* padded rows don't fit, capture into camera_buffer and copy the rows out */
+    if (padded_size > size) {
+        CAM_ei_capture_frame();
+        memcpy(dst, camera_buffer, row_bytes * nn_ei_height);
+#ifdef USE_DCACHE
+        SCB_CleanDCache_by_Addr(dst, row_bytes * nn_ei_height);
+#endif
+        return dst;
+    }
+
+    CAM_IspUpdate();
+
+    /* NN camera single capture Snapshot */
+    app_nn_pipe_snapshot(dst);
+
+    /* NPU reads dst from memory, only drop lines the CPU may have fetched while DCMIPP was writing */
+#ifdef USE_DCACHE
+    SCB_InvalidateDCache_by_Addr(dst, size);
+#endif
+
+    CAM_ei_PackFrame(dst);
+
+    return dst;
+}
+
 void CAM_Init(void)
 {
   CMW_CameraInit_t cam_conf;
@@ -33,6 +33,7 @@
 
 CACHEAXI_HandleTypeDef hcacheaxi;
 UART_HandleTypeDef huart1;
+DMA_HandleTypeDef hdma_usart1_tx;
 
 static TX_THREAD main_thread;
 static uint8_t main_tread_stack[4096];
@@ -308,6 +309,39 @@ static void CONSOLE_Config()
   {
     while (1);
   }
+
+  /* USART1 TX drained by GPDMA1 channel 0 (ei_write TX ring) */
+  __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+  hdma_usart1_tx.Instance                   = GPDMA1_Channel0;
+  hdma_usart1_tx.Init.Request               = GPDMA1_REQUEST_USART1_TX;
+  hdma_usart1_tx.Init.BlkHWRequest          = DMA_BREQ_SINGLE_BURST;
+  hdma_usart1_tx.Init.Direction             = DMA_MEMORY_TO_PERIPH;
+  hdma_usart1_tx.Init.SrcInc                = DMA_SINC_INCREMENTED;
+  hdma_usart1_tx.Init.DestInc               = DMA_DINC_FIXED;
+  hdma_usart1_tx.Init.SrcDataWidth          = DMA_SRC_DATAWIDTH_BYTE;
+  hdma_usart1_tx.Init.DestDataWidth         = DMA_DEST_DATAWIDTH_BYTE;
+  hdma_usart1_tx.Init.Priority              = DMA_LOW_PRIORITY_LOW_WEIGHT;
+  hdma_usart1_tx.Init.SrcBurstLength        = 1;
+  hdma_usart1_tx.Init.DestBurstLength       = 1;
+  hdma_usart1_tx.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT1 | DMA_DEST_ALLOCATED_PORT1;
+  hdma_usart1_tx.Init.TransferEventMode     = DMA_TCEM_BLOCK_TRANSFER;
+  hdma_usart1_tx.Init.Mode                  = DMA_NORMAL;
+  if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK)
+  {
+    while (1);
+  }
+  __HAL_LINKDMA(&huart1, hdmatx, hdma_usart1_tx);
+  if (HAL_DMA_ConfigChannelAttributes(&hdma_usart1_tx, DMA_CHANNEL_PRIV | DMA_CHANNEL_SEC |
+                                      DMA_CHANNEL_SRC_SEC | DMA_CHANNEL_DEST_SEC) != HAL_OK)
+  {
+    while (1);
+  }
+
+  HAL_NVIC_SetPriority(GPDMA1_Channel0_IRQn, 0x07, 0);
+  HAL_NVIC_EnableIRQ(GPDMA1_Channel0_IRQn);
+  HAL_NVIC_SetPriority(USART1_IRQn, 0x07, 0);
+  HAL_NVIC_EnableIRQ(USART1_IRQn);
 }
 
 static int main_threadx()
@@ -0,0 +1,348 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host benchmark of the lookup table path of extract_image_features_quantized()
+ * against the per pixel float code it replaced (kept below as
+ * reference_extract_image_features_quantized()), for every image scaling mode,
+ * RGB and grayscale models, the default (1/255, -128) and a custom input
+ * quantisation. The new code is timed both through signal->get_data (packed
+ * float pixels) and on a byte frame buffer (signal->image); the speedup column
+ * is reference against frame buffer.
+ *
+ * The reference predates EI_CLASSIFIER_IMAGE_SCALING_MIN1_1 and
+ * EI_CLASSIFIER_IMAGE_SCALING_BGR_SUBTRACT_IMAGENET_MEAN (it left those
+ * pixels in 0..255), so for these modes the outputs are timed, not compared.
+ *
+ * Not part of the firmware build. From the edgeimpulse directory:
+ *   g++ -std=gnu++11 -O2 -I. benchmarks/image_quantize_benchmark.cpp -o image_quantize_benchmark
+ *   ./image_quantize_benchmark
+ */
+
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/classifier/ei_run_dsp.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define BENCH_ITERATIONS    10
+#define BENCH_WIDTH         320
+#define BENCH_HEIGHT        320
+
+void ei_printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void *ei_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void *ei_calloc(size_t nitems, size_t size)
+{
+    return calloc(nitems, size);
+}
+
+void ei_free(void *ptr)
+{
+    free(ptr);
+}
+
+// ei_run_dsp.h references the FFT, none of the image code uses it
+kiss_fftr_cfg kiss_fftr_alloc(int nfft, int inverse_fft, void *mem, size_t *lenmem, size_t *memallocated)
+{
+    return NULL;
+}
+
+void kiss_fftr(kiss_fftr_cfg cfg, const kiss_fft_scalar *timedata, kiss_fft_cpx *freqdata)
+{
+}
+
+// The reference cast out of range floats straight to int8_t, which is undefined; the new code
+// saturates, and so does the reference here so the outputs can be compared
+static int8_t reference_saturate(float q)
+{
+    if (q < -128.0f) q = -128.0f;
+    else if (q > 127.0f) q = 127.0f;
+    return static_cast<int8_t>(static_cast<int32_t>(q));
+}
+
+// extract_image_features_quantized() before the lookup tables
+static int reference_extract_image_features_quantized(signal_t *signal, matrix_i8_t *output_matrix, void *config_ptr, float scale, float zero_point, const float frequency,
+                                                        int image_scaling) {
+    ei_dsp_config_image_t config = *((ei_dsp_config_image_t*)config_ptr);
+
+    int16_t channel_count = strcmp(config.channels, "Grayscale") == 0 ? 1 : 3;
+
+    size_t output_ix = 0;
+
+    const int32_t iRedToGray = (int32_t)(0.299f * 65536.0f);
+    const int32_t iGreenToGray = (int32_t)(0.587f * 65536.0f);
+    const int32_t iBlueToGray = (int32_t)(0.114f * 65536.0f);
+
+    static const float torch_mean[] = { 0.485, 0.456, 0.406 };
+    static const float torch_std[] = { 0.229, 0.224, 0.225 };
+
+#if defined(EI_DSP_IMAGE_BUFFER_STATIC_SIZE)
+    const size_t page_size = EI_DSP_IMAGE_BUFFER_STATIC_SIZE;
+#else
+    const size_t page_size = 1024;
+#endif
+
+    // buffered read from the signal
+    size_t bytes_left = signal->total_length;
+    for (size_t ix = 0; ix < signal->total_length; ix += page_size) {
+        size_t elements_to_read = bytes_left > page_size ? page_size : bytes_left;
+
+#if defined(EI_DSP_IMAGE_BUFFER_STATIC_SIZE)
+        matrix_t input_matrix(elements_to_read, config.axes, ei_dsp_image_buffer);
+#else
+        matrix_t input_matrix(elements_to_read, config.axes);
+#endif
+        if (!input_matrix.buffer) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        signal->get_data(ix, elements_to_read, input_matrix.buffer);
+
+        for (size_t jx = 0; jx < elements_to_read; jx++) {
+            uint32_t pixel = static_cast<uint32_t>(input_matrix.buffer[jx]);
+
+            if (channel_count == 3) {
+                // fast code path
+                if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+                    int32_t r = static_cast<int32_t>(pixel >> 16 & 0xff);
+                    int32_t g = static_cast<int32_t>(pixel >> 8 & 0xff);
+                    int32_t b = static_cast<int32_t>(pixel & 0xff);
+
+                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(r + zero_point);
+                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(g + zero_point);
+                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(b + zero_point);
+                }
+                // slow code path
+                else {
+                    float r = static_cast<float>(pixel >> 16 & 0xff);
+                    float g = static_cast<float>(pixel >> 8 & 0xff);
+                    float b = static_cast<float>(pixel & 0xff);
+
+                    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+                        r /= 255.0f;
+                        g /= 255.0f;
+                        b /= 255.0f;
+                    }
+                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
+                        r /= 255.0f;
+                        g /= 255.0f;
+                        b /= 255.0f;
+
+                        r = (r - torch_mean[0]) / torch_std[0];
+                        g = (g - torch_mean[1]) / torch_std[1];
+                        b = (b - torch_mean[2]) / torch_std[2];
+                    }
+                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
+                        r -= 128.0f;
+                        g -= 128.0f;
+                        b -= 128.0f;
+                    }
+
+                    output_matrix->buffer[output_ix++] = reference_saturate(round(r / scale) + zero_point);
+                    output_matrix->buffer[output_ix++] = reference_saturate(round(g / scale) + zero_point);
+                    output_matrix->buffer[output_ix++] = reference_saturate(round(b / scale) + zero_point);
+                }
+            }
+            else {
+                // fast code path
+                if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+                    int32_t r = static_cast<int32_t>(pixel >> 16 & 0xff);
+                    int32_t g = static_cast<int32_t>(pixel >> 8 & 0xff);
+                    int32_t b = static_cast<int32_t>(pixel & 0xff);
+
+                    // ITU-R 601-2 luma transform
+                    // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
+                    int32_t gray = (iRedToGray * r) + (iGreenToGray * g) + (iBlueToGray * b);
+                    gray >>= 16; // scale down to int8_t
+                    gray += zero_point;
+                    if (gray < - 128) gray = -128;
+                    else if (gray > 127) gray = 127;
+                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(gray);
+                }
+                // slow code path
+                else {
+                    float r = static_cast<float>(pixel >> 16 & 0xff);
+                    float g = static_cast<float>(pixel >> 8 & 0xff);
+                    float b = static_cast<float>(pixel & 0xff);
+
+                    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+                        r /= 255.0f;
+                        g /= 255.0f;
+                        b /= 255.0f;
+                    }
+                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
+                        r /= 255.0f;
+                        g /= 255.0f;
+                        b /= 255.0f;
+
+                        r = (r - torch_mean[0]) / torch_std[0];
+                        g = (g - torch_mean[1]) / torch_std[1];
+                        b = (b - torch_mean[2]) / torch_std[2];
+                    }
+                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
+                        r -= 128.0f;
+                        g -= 128.0f;
+                        b -= 128.0f;
+                    }
+
+                    // ITU-R 601-2 luma transform
+                    // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
+                    float v = (0.299f * r) + (0.587f * g) + (0.114f * b);
+                    output_matrix->buffer[output_ix++] = reference_saturate(round(v / scale) + zero_point);
+                }
+            }
+        }
+
+        bytes_left -= elements_to_read;
+
+    }
+    return EIDSP_OK;
+}
+
+static std::vector<uint8_t> frame;
+
+// packed RGB888 pixels as floats, like the camera signal
+static int get_frame_data(size_t offset, size_t length, float *out_ptr)
+{
+    for (size_t ix = 0; ix < length; ix++) {
+        const uint8_t *pixel = &frame[(offset + ix) * 3];
+        out_ptr[ix] = (float)((pixel[0] << 16) + (pixel[1] << 8) + pixel[2]);
+    }
+    return 0;
+}
+
+static double elapsed_us(std::chrono::steady_clock::time_point start,
+                         std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::micro>(end - start).count() / BENCH_ITERATIONS;
+}
+
+int main(void)
+{
+    static const struct {
+        int mode;
+        const char *name;
+        bool in_reference;
+    } scalings[] = {
+        { EI_CLASSIFIER_IMAGE_SCALING_NONE, "NONE", true },
+        { EI_CLASSIFIER_IMAGE_SCALING_0_255, "0_255", true },
+        { EI_CLASSIFIER_IMAGE_SCALING_TORCH, "TORCH", true },
+        { EI_CLASSIFIER_IMAGE_SCALING_MIN128_127, "MIN128_127", true },
+        { EI_CLASSIFIER_IMAGE_SCALING_MIN1_1, "MIN1_1", false },
+        { EI_CLASSIFIER_IMAGE_SCALING_BGR_SUBTRACT_IMAGENET_MEAN, "BGR_IMAGENET", false },
+    };
+    static const char *channels[] = { "RGB", "Grayscale" };
+    const size_t pixels = BENCH_WIDTH * BENCH_HEIGHT;
+    int failures = 0;
+
+    frame.resize(pixels * 3);
+    srand(1234);
+    for (size_t ix = 0; ix < frame.size(); ix++) {
+        frame[ix] = (uint8_t)rand();
+    }
+
+    image_view_t view = { frame.data(), BENCH_WIDTH, BENCH_HEIGHT, BENCH_WIDTH * 3, EI_IMAGE_FORMAT_RGB888 };
+
+    printf("%-9s %-12s %-7s %14s %14s %14s %8s\n", "channels", "scaling", "quant",
+           "reference us", "get_data us", "frame us", "speedup");
+
+    for (size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++) {
+        for (size_t s = 0; s < sizeof(scalings) / sizeof(scalings[0]); s++) {
+            for (int custom = 0; custom < 2; custom++) {
+                ei_dsp_config_image_t config = { };
+                config.axes = 1;
+                config.channels = channels[c];
+
+                // custom: a typical int8 input quantisation for the scaled range
+                float scale = custom ? 0.0186f : 0.003921568859368563f;
+                float zero_point = custom ? -3.0f : -128.0f;
+                size_t features = pixels * (c == 0 ? 3 : 1);
+
+                matrix_i8_t ref_out(1, features), get_data_out(1, features), frame_out(1, features);
+                signal_t signal;
+                signal.total_length = pixels;
+                signal.get_data = &get_frame_data;
+
+                auto t0 = std::chrono::steady_clock::now();
+                for (int i = 0; i < BENCH_ITERATIONS; i++) {
+                    reference_extract_image_features_quantized(&signal, &ref_out, &config, scale, zero_point, 0, scalings[s].mode);
+                }
+                auto t1 = std::chrono::steady_clock::now();
+                for (int i = 0; i < BENCH_ITERATIONS; i++) {
+                    extract_image_features_quantized(&signal, &get_data_out, &config, scale, zero_point, 0, scalings[s].mode);
+                }
+                auto t2 = std::chrono::steady_clock::now();
+                signal.image = &view;
+                for (int i = 0; i < BENCH_ITERATIONS; i++) {
+                    extract_image_features_quantized(&signal, &frame_out, &config, scale, zero_point, 0, scalings[s].mode);
+                }
+                auto t3 = std::chrono::steady_clock::now();
+
+                const char *result = "";
+                if (memcmp(get_data_out.buffer, frame_out.buffer, features) != 0) {
+                    result = "  MISMATCH (frame)";
+                    failures++;
+                }
+                else if (scalings[s].in_reference && memcmp(ref_out.buffer, get_data_out.buffer, features) != 0) {
+                    result = "  MISMATCH";
+                    failures++;
+                }
+                else if (!scalings[s].in_reference) {
+                    result = "  (not compared)";
+                }
+
+                double ref_us = elapsed_us(t0, t1);
+                printf("%-9s %-12s %-7s %14.0f %14.0f %14.0f %7.2fx%s\n", channels[c], scalings[s].name,
+                       custom ? "custom" : "default", ref_us, elapsed_us(t1, t2), elapsed_us(t2, t3),
+                       ref_us / elapsed_us(t2, t3), result);
+            }
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,238 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host benchmark of ei_nms_sorted() against the priority queue NMS it
+ * replaced (tensorflow's reference NonMaxSuppression, kept below as
+ * reference_nms()). Both run hard NMS on the same random detections at 100,
+ * 1000 and 8400 (YOLOv8 at 640x640) boxes and must select the same boxes.
+ *
+ * Not part of the firmware build. From the edgeimpulse directory:
+ *   g++ -std=gnu++11 -O2 -I. benchmarks/nms_benchmark.cpp -o nms_benchmark
+ *   ./nms_benchmark
+ */
+
+#include "edge-impulse-sdk/classifier/ei_nms.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <queue>
+#include <vector>
+
+#define BENCH_ITERATIONS    20
+#define BENCH_IOU_THRESHOLD 0.45f
+#define BENCH_SCORE_THRESHOLD 0.25f
+
+void ei_printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void *ei_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void ei_free(void *ptr)
+{
+    free(ptr);
+}
+
+// The code below comes from tensorflow/lite/kernels/internal/reference/non_max_suppression.h
+// Copyright 2019 The TensorFlow Authors.  All rights reserved.
+// Licensed under the Apache License, Version 2.0
+// (soft NMS removed, the firmware only ran it with soft_nms_sigma == 0)
+static float reference_iou(const float *boxes, const int i, const int j)
+{
+    auto &box_i = reinterpret_cast<const BoxCornerEncoding *>(boxes)[i];
+    auto &box_j = reinterpret_cast<const BoxCornerEncoding *>(boxes)[j];
+    const float box_i_y_min = std::min<float>(box_i.y1, box_i.y2);
+    const float box_i_y_max = std::max<float>(box_i.y1, box_i.y2);
+    const float box_i_x_min = std::min<float>(box_i.x1, box_i.x2);
+    const float box_i_x_max = std::max<float>(box_i.x1, box_i.x2);
+    const float box_j_y_min = std::min<float>(box_j.y1, box_j.y2);
+    const float box_j_y_max = std::max<float>(box_j.y1, box_j.y2);
+    const float box_j_x_min = std::min<float>(box_j.x1, box_j.x2);
+    const float box_j_x_max = std::max<float>(box_j.x1, box_j.x2);
+
+    const float area_i = (box_i_y_max - box_i_y_min) * (box_i_x_max - box_i_x_min);
+    const float area_j = (box_j_y_max - box_j_y_min) * (box_j_x_max - box_j_x_min);
+    if (area_i <= 0 || area_j <= 0) return 0.0;
+    const float intersection_ymax = std::min<float>(box_i_y_max, box_j_y_max);
+    const float intersection_xmax = std::min<float>(box_i_x_max, box_j_x_max);
+    const float intersection_ymin = std::max<float>(box_i_y_min, box_j_y_min);
+    const float intersection_xmin = std::max<float>(box_i_x_min, box_j_x_min);
+    const float intersection_area =
+        std::max<float>(intersection_ymax - intersection_ymin, 0.0) *
+        std::max<float>(intersection_xmax - intersection_xmin, 0.0);
+    return intersection_area / (area_i + area_j - intersection_area);
+}
+
+static int reference_nms(const float *boxes, const int num_boxes,
+                         const float *scores, const int max_output_size,
+                         const float iou_threshold, const float score_threshold,
+                         int *selected_indices)
+{
+    struct Candidate {
+        int index;
+        float score;
+        int suppress_begin_index;
+    };
+
+    auto cmp = [](const Candidate bs_i, const Candidate bs_j) {
+        return bs_i.score < bs_j.score;
+    };
+    std::priority_queue<Candidate, std::deque<Candidate>, decltype(cmp)>
+        candidate_priority_queue(cmp);
+    for (int i = 0; i < num_boxes; ++i) {
+        if (scores[i] > score_threshold) {
+            candidate_priority_queue.emplace(Candidate({ i, scores[i], 0 }));
+        }
+    }
+
+    int num_selected = 0;
+    int num_outputs = std::min(static_cast<int>(candidate_priority_queue.size()),
+                               max_output_size);
+
+    while (num_selected < num_outputs && !candidate_priority_queue.empty()) {
+        Candidate next_candidate = candidate_priority_queue.top();
+        candidate_priority_queue.pop();
+
+        bool should_hard_suppress = false;
+        for (int j = num_selected - 1; j >= next_candidate.suppress_begin_index; --j) {
+            const float iou = reference_iou(boxes, next_candidate.index, selected_indices[j]);
+            if (iou >= iou_threshold) {
+                should_hard_suppress = true;
+                break;
+            }
+        }
+        next_candidate.suppress_begin_index = num_selected;
+
+        if (!should_hard_suppress) {
+            selected_indices[num_selected++] = next_candidate.index;
+        }
+    }
+
+    return num_selected;
+}
+// End of the tensorflow code
+
+// Detections are clustered around a few objects, like the raw output of a
+// detector before NMS. Fixed seed so runs are comparable.
+static void make_detections(int count, std::vector<float> &boxes, std::vector<float> &scores)
+{
+    const int objects = 1 + (count / 50);
+    boxes.resize(count * 4);
+    scores.resize(count);
+
+    srand(1234);
+    auto frand = [](float lo, float hi) {
+        return lo + ((hi - lo) * (float)rand() / (float)RAND_MAX);
+    };
+
+    for (int i = 0; i < count; i++) {
+        float cy = (float)((i % objects) * 37 % 640);
+        float cx = (float)((i % objects) * 91 % 640);
+        float h = frand(20.0f, 120.0f);
+        float w = frand(20.0f, 120.0f);
+        cy += frand(-15.0f, 15.0f);
+        cx += frand(-15.0f, 15.0f);
+
+        boxes[(i * 4) + 0] = cy - (h / 2);
+        boxes[(i * 4) + 1] = cx - (w / 2);
+        boxes[(i * 4) + 2] = cy + (h / 2);
+        boxes[(i * 4) + 3] = cx + (w / 2);
+        scores[i] = frand(0.0f, 1.0f);
+    }
+}
+
+static double elapsed_us(std::chrono::steady_clock::time_point start,
+                         std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::micro>(end - start).count() / BENCH_ITERATIONS;
+}
+
+int main(void)
+{
+    static const int counts[] = { 100, 1000, 8400 };
+    ei_nms_workspace_t ws = {};
+    int failures = 0;
+
+    printf("%6s %10s %14s %14s %8s\n", "boxes", "selected", "reference us", "sorted us", "speedup");
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        const int count = counts[c];
+        std::vector<float> boxes, scores;
+        std::vector<int> ref_selected(count), new_selected(count);
+        int ref_count = 0, new_count = 0;
+
+        make_detections(count, boxes, scores);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            ref_count = reference_nms(boxes.data(), count, scores.data(), count,
+                                      BENCH_IOU_THRESHOLD, BENCH_SCORE_THRESHOLD,
+                                      ref_selected.data());
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            new_count = ei_nms_sorted(&ws, boxes.data(), count, scores.data(), NULL,
+                                      count, 0, BENCH_IOU_THRESHOLD, BENCH_SCORE_THRESHOLD,
+                                      new_selected.data());
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        bool same = (ref_count == new_count) &&
+            (memcmp(ref_selected.data(), new_selected.data(), ref_count * sizeof(int)) == 0);
+        if (!same) {
+            failures++;
+        }
+
+        double ref_us = elapsed_us(t0, t1);
+        double new_us = elapsed_us(t1, t2);
+        printf("%6d %10d %14.1f %14.1f %7.2fx%s\n", count, new_count, ref_us, new_us,
+               ref_us / new_us, same ? "" : "  MISMATCH");
+    }
+
+    ei_free(ws.buffer);
+
+    return failures ? 1 : 0;
+}
@@ -87,139 +87,180 @@ __attribute__((unused)) inline float sigmoid(float a) {
 }
 
 #ifdef EI_HAS_FOMO
-typedef struct cube {
-    size_t x;
-    size_t y;
-    size_t width;
-    size_t height;
-    float confidence;
-    const char *label;
-} ei_classifier_cube_t;
+// Upper bound on the number of objects returned by the FOMO decoder (at least
+// EI_CLASSIFIER_OBJECT_DETECTION_COUNT), objects past it are dropped in scan order
+#ifndef EI_CLASSIFIER_FOMO_MAX_OBJECTS
+#define EI_CLASSIFIER_FOMO_MAX_OBJECTS 64
+#endif
+
+#define EI_FOMO_RESULTS_SIZE (EI_CLASSIFIER_FOMO_MAX_OBJECTS > EI_CLASSIFIER_OBJECT_DETECTION_COUNT ? \
+                              EI_CLASSIFIER_FOMO_MAX_OBJECTS : EI_CLASSIFIER_OBJECT_DETECTION_COUNT)
 
 /**
- * Checks whether a new section overlaps with a cube,
- * and if so, will **update the cube**
+ * Connected component of above threshold cells of one class (8-connected), with
+ * its bounding box in grid cells and the highest (still quantised) cell value.
+ * Components are kept in a union-find forest, only roots hold valid totals.
  */
-__attribute__((unused)) static bool ei_cube_check_overlap(ei_classifier_cube_t *c, int x, int y, int width, int height, float confidence) {
-    bool is_overlapping = !(c->x + c->width < x || c->y + c->height < y || c->x > x + width || c->y > y + height);
-    if (!is_overlapping) return false;
-
-    // if we overlap, but the x of the new box is lower than the x of the current box
-    if (x < c->x) {
-        // update x to match new box and make width larger (by the diff between the boxes)
-        c->x = x;
-        c->width += c->x - x;
-    }
-    // if we overlap, but the y of the new box is lower than the y of the current box
-    if (y < c->y) {
-        // update y to match new box and make height larger (by the diff between the boxes)
-        c->y = y;
-        c->height += c->y - y;
-    }
-    // if we overlap, and x+width of the new box is higher than the x+width of the current box
-    if (x + width > c->x + c->width) {
-        // just make the box wider
-        c->width += (x + width) - (c->x + c->width);
-    }
-    // if we overlap, and y+height of the new box is higher than the y+height of the current box
-    if (y + height > c->y + c->height) {
-        // just make the box higher
-        c->height += (y + height) - (c->y + c->height);
-    }
-    // if the new box has higher confidence, then override confidence of the whole box
-    if (confidence > c->confidence) {
-        c->confidence = confidence;
+template<typename T>
+struct ei_fomo_component_t {
+    int32_t parent;
+    // raster index of the first cell, objects are returned in scan order
+    uint32_t first;
+    uint16_t class_ix;
+    uint16_t x0;
+    uint16_t y0;
+    uint16_t x1;
+    uint16_t y1;
+    T max;
+};
+
+template<typename T>
+static inline int32_t ei_fomo_find(std::vector<ei_fomo_component_t<T>> &components, int32_t ix) {
+    // path halving
+    while (components[ix].parent != ix) {
+        components[ix].parent = components[components[ix].parent].parent;
+        ix = components[ix].parent;
     }
-    return true;
+    return ix;
 }
 
-__attribute__((unused)) static void ei_handle_cube(std::vector<ei_classifier_cube_t*> *cubes, int x, int y, float vf, const char *label, float detection_threshold) {
-    if (vf < detection_threshold) return;
-
-    bool has_overlapping = false;
-    int width = 1;
-    int height = 1;
+/**
+ * Label the cells of one class at or above threshold in a single raster scan. Every cell
+ * joins the components of its already scanned neighbours (W, NW, N, NE), merging them
+ * when it connects more than one.
+ */
+template<typename T, typename TThreshold>
+static void ei_fomo_label_class(const T *data,
+                                int rows,
+                                int cols,
+                                int label_count,
+                                int class_ix,
+                                TThreshold threshold,
+                                std::vector<int32_t> &labels,
+                                std::vector<ei_fomo_component_t<T>> &components) {
+    const size_t stride = label_count + 1;
+
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            const uint32_t cell = y * cols + x;
+            const T v = data[cell * stride + class_ix + 1];
+
+            if (v < threshold) {
+                labels[cell] = -1;
+                continue;
+            }
 
-    for (auto c : *cubes) {
-        // not cube for same class? continue
-        if (strcmp(c->label, label) != 0) continue;
+            int32_t root = -1;
+            const int32_t neighbours[4] = {
+                x > 0 ? labels[cell - 1] : -1,
+                y > 0 && x > 0 ? labels[cell - cols - 1] : -1,
+                y > 0 ? labels[cell - cols] : -1,
+                y > 0 && x < cols - 1 ? labels[cell - cols + 1] : -1
+            };
+
+            for (int n = 0; n < 4; n++) {
+                if (neighbours[n] < 0) {
+                    continue;
+                }
+                int32_t other = ei_fomo_find(components, neighbours[n]);
+                if (root < 0) {
+                    root = other;
+                }
+                else if (other != root) {
+                    // the cell connects two components, fold the other one into root
+                    ei_fomo_component_t<T> &r = components[root];
+                    const ei_fomo_component_t<T> &o = components[other];
+                    r.first = std::min(r.first, o.first);
+                    r.x0 = std::min(r.x0, o.x0);
+                    r.y0 = std::min(r.y0, o.y0);
+                    r.x1 = std::max(r.x1, o.x1);
+                    r.y1 = std::max(r.y1, o.y1);
+                    r.max = std::max(r.max, o.max);
+                    components[other].parent = root;
+                }
+            }
 
-        if (ei_cube_check_overlap(c, x, y, width, height, vf)) {
-            has_overlapping = true;
-            break;
+            if (root < 0) {
+                root = (int32_t)components.size();
+                ei_fomo_component_t<T> c;
+                c.parent = root;
+                c.first = cell;
+                c.class_ix = (uint16_t)class_ix;
+                c.x0 = c.x1 = (uint16_t)x;
+                c.y0 = c.y1 = (uint16_t)y;
+                c.max = v;
+                components.push_back(c);
+            }
+            else {
+                ei_fomo_component_t<T> &r = components[root];
+                r.x0 = std::min(r.x0, (uint16_t)x);
+                r.x1 = std::max(r.x1, (uint16_t)x);
+                r.y1 = std::max(r.y1, (uint16_t)y);
+                r.max = std::max(r.max, v);
+            }
+            labels[cell] = root;
         }
     }
-
-    if (!has_overlapping) {
-        ei_classifier_cube_t *cube = new ei_classifier_cube_t();
-        cube->x = x;
-        cube->y = y;
-        cube->width = 1;
-        cube->height = 1;
-        cube->confidence = vf;
-        cube->label = label;
-        cubes->push_back(cube);
-    }
 }
 
-__attribute__((unused)) static void fill_result_struct_from_cubes(ei_impulse_result_t *result, std::vector<ei_classifier_cube_t*> *cubes, int out_width_factor, uint32_t object_detection_count) {
-    std::vector<ei_classifier_cube_t*> bbs;
-    static std::vector<ei_impulse_result_bounding_box_t> results;
-    int added_boxes_count = 0;
-    results.clear();
-
-    for (auto sc : *cubes) {
-        bool has_overlapping = false;
-
-        int x = sc->x;
-        int y = sc->y;
-        int width = sc->width;
-        int height = sc->height;
-        const char *label = sc->label;
-        float vf = sc->confidence;
-
-        for (auto c : bbs) {
-            // not cube for same class? continue
-            if (strcmp(c->label, label) != 0) continue;
+/**
+ * Decode a FOMO output grid (rows x cols cells of label_count + 1 values, background first)
+ * into one bounding box per connected component of every class. Cells are compared with
+ * the threshold in the data type of the grid, to_float only runs once per object.
+ */
+template<typename T, typename TThreshold, typename TToFloat>
+static void ei_fomo_decode(const ei_impulse_t *impulse,
+                           ei_impulse_result_t *result,
+                           const T *data,
+                           int rows,
+                           int cols,
+                           TThreshold threshold,
+                           TToFloat to_float) {
+    // kept between calls, so steady state inference does not allocate
+    static std::vector<int32_t> labels;
+    static std::vector<ei_fomo_component_t<T>> components;
+    static std::vector<int32_t> roots;
+    static ei_impulse_result_bounding_box_t results[EI_FOMO_RESULTS_SIZE];
+
+    const int out_width_factor = impulse->input_width / rows;
+
+    labels.resize(rows * cols);
+    components.clear();
+    for (int ix = 0; ix < (int)impulse->label_count; ix++) {
+        ei_fomo_label_class(data, rows, cols, impulse->label_count, ix, threshold, labels, components);
+    }
 
-            if (ei_cube_check_overlap(c, x, y, width, height, vf)) {
-                has_overlapping = true;
-                break;
-            }
+    roots.clear();
+    for (int32_t ix = 0; ix < (int32_t)components.size(); ix++) {
+        if (components[ix].parent == ix) {
+            roots.push_back(ix);
         }
-
-        if (has_overlapping) {
-            continue;
-        }
-
-        bbs.push_back(sc);
-
-        ei_impulse_result_bounding_box_t tmp = {
-            .label = sc->label,
-            .x = (uint32_t)(sc->x * out_width_factor),
-            .y = (uint32_t)(sc->y * out_width_factor),
-            .width = (uint32_t)(sc->width * out_width_factor),
-            .height = (uint32_t)(sc->height * out_width_factor),
-            .value = sc->confidence
-        };
-
-        results.push_back(tmp);
-        added_boxes_count++;
     }
+    // scan order of the first cell, then class, as cells were visited before
+    std::sort(roots.begin(), roots.end(), [](const int32_t lhs, const int32_t rhs) {
+        const ei_fomo_component_t<T> &l = components[lhs];
+        const ei_fomo_component_t<T> &r = components[rhs];
+        return l.first < r.first || (l.first == r.first && l.class_ix < r.class_ix);
+    });
 
-    // if we didn't detect min required objects, fill the rest with fixed value
-    if (added_boxes_count < object_detection_count) {
-        results.resize(object_detection_count);
-        for (size_t ix = added_boxes_count; ix < object_detection_count; ix++) {
-            results[ix].value = 0.0f;
-        }
+    size_t added_boxes_count = std::min(roots.size(), (size_t)EI_FOMO_RESULTS_SIZE);
+    for (size_t ix = 0; ix < added_boxes_count; ix++) {
+        const ei_fomo_component_t<T> &c = components[roots[ix]];
+        results[ix].label = impulse->categories[c.class_ix];
+        results[ix].x = (uint32_t)(c.x0 * out_width_factor);
+        results[ix].y = (uint32_t)(c.y0 * out_width_factor);
+        results[ix].width = (uint32_t)((c.x1 - c.x0 + 1) * out_width_factor);
+        results[ix].height = (uint32_t)((c.y1 - c.y0 + 1) * out_width_factor);
+        results[ix].value = to_float(c.max);
     }
 
-    for (auto c : *cubes) {
-        delete c;
+    // if we didn't detect min required objects, fill the rest with fixed value
+    const size_t min_count = std::min((size_t)impulse->object_detection_count, (size_t)EI_FOMO_RESULTS_SIZE);
+    for (size_t ix = added_boxes_count; ix < min_count; ix++) {
+        results[ix] = { 0 };
     }
 
-    result->bounding_boxes = results.data();
+    result->bounding_boxes = results;
     result->bounding_boxes_count = added_boxes_count;
 }
 #endif
@@ -231,24 +272,8 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_fomo(cons
                                                                             int out_width,
                                                                             int out_height) {
 #ifdef EI_HAS_FOMO
-    std::vector<ei_classifier_cube_t*> cubes;
-
-    int out_width_factor = impulse->input_width / out_width;
-
-    for (size_t y = 0; y < out_width; y++) {
-        // ei_printf("    [ ");
-        for (size_t x = 0; x < out_height; x++) {
-            size_t loc = ((y * out_height) + x) * (impulse->label_count + 1);
-
-            for (size_t ix = 1; ix < impulse->label_count + 1; ix++) {
-                float vf = data[loc+ix];
-
-                ei_handle_cube(&cubes, x, y, vf, impulse->categories[ix - 1], block_config->threshold);
-            }
-        }
-    }
-
-    fill_result_struct_from_cubes(result, &cubes, out_width_factor, impulse->object_detection_count);
+    ei_fomo_decode(impulse, result, data, out_width, out_height, block_config->threshold,
+                   [](float v) { return v; });
 
     return EI_IMPULSE_OK;
 #else
@@ -265,25 +290,19 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_i8_fomo(const
                                                                            int out_width,
                                                                            int out_height) {
 #ifdef EI_HAS_FOMO
-    std::vector<ei_classifier_cube_t*> cubes;
-
-    int out_width_factor = impulse->input_width / out_width;
-
-    for (size_t y = 0; y < out_width; y++) {
-        // ei_printf("    [ ");
-        for (size_t x = 0; x < out_height; x++) {
-            size_t loc = ((y * out_height) + x) * (impulse->label_count + 1);
-
-            for (size_t ix = 1; ix < impulse->label_count + 1; ix++) {
-                int8_t v = data[loc+ix];
-                float vf = static_cast<float>(v - zero_point) * scale;
-
-                ei_handle_cube(&cubes, x, y, vf, impulse->categories[ix - 1], block_config->threshold);
-            }
+    auto dequantize = [zero_point, scale](int8_t v) { return static_cast<float>(v - zero_point) * scale; };
+
+    // lowest quantised value that passes the threshold once dequantised (128: none does),
+    // found with the same arithmetic so the decision is the same as in float
+    int threshold = 128;
+    for (int v = -128; v <= 127; v++) {
+        if (!(dequantize((int8_t)v) < block_config->threshold)) {
+            threshold = v;
+            break;
         }
     }
 
-    fill_result_struct_from_cubes(result, &cubes, out_width_factor, impulse->object_detection_count);
+    ei_fomo_decode(impulse, result, data, out_width, out_height, threshold, dequantize);
 
     return EI_IMPULSE_OK;
 #else
@@ -1748,7 +1767,87 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_f32_yolov2(co
 #endif // #ifdef EI_HAS_YOLOV7
 }
 
+#if (EI_HAS_YOLO_PRO == 1) || (EI_HAS_YOLOV11 == 1)
+#include <algorithm>
+#include <limits>
+#if defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1)
+#include <arm_mve.h>
+#endif
+
+// number of scores rejected at once by ei_yolo_max_score() before looking at single elements
+#ifndef EI_CLASSIFIER_YOLO_SCORE_BLOCK_SIZE
+#define EI_CLASSIFIER_YOLO_SCORE_BLOCK_SIZE 64
+#endif
+
+/**
+ * Largest raw value in data[0..count)
+ */
+template<typename T>
+static inline T ei_yolo_max_score(const T *data, size_t count) {
+    T max_val = std::numeric_limits<T>::lowest();
+    for (size_t ix = 0; ix < count; ix++) {
+        max_val = std::max(max_val, data[ix]);
+    }
+    return max_val;
+}
+
+#if defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1)
+template<>
+inline uint8_t ei_yolo_max_score<uint8_t>(const uint8_t *data, size_t count) {
+    uint8_t max_val = 0;
+    while (count > 0) {
+        mve_pred16_t p = vctp8q(count);
+        max_val = vmaxvq_p_u8(max_val, vld1q_z_u8(data, p), p);
+        data += 16;
+        count = (count > 16) ? (count - 16) : 0;
+    }
+    return max_val;
+}
+
+template<>
+inline int8_t ei_yolo_max_score<int8_t>(const int8_t *data, size_t count) {
+    int8_t max_val = INT8_MIN;
+    while (count > 0) {
+        mve_pred16_t p = vctp8q(count);
+        max_val = vmaxvq_p_s8(max_val, vld1q_z_s8(data, p), p);
+        data += 16;
+        count = (count > 16) ? (count - 16) : 0;
+    }
+    return max_val;
+}
+#endif // __ARM_FEATURE_MVE
+
+/**
+ * Convert a score threshold to the raw output domain, so scores can be
+ * rejected without dequantizing them. The value is rounded down: anything
+ * that passes still has to pass the float comparison.
+ */
+template<typename T>
+static inline T ei_yolo_raw_threshold(float threshold, float zero_point, float scale) {
+    if (scale <= 0.0f) {
+        return std::numeric_limits<T>::lowest();
+    }
+    float raw = (threshold / scale) + zero_point;
+    if (!std::numeric_limits<T>::is_integer) {
+        return static_cast<T>(raw);
+    }
+    raw = std::floor(raw);
+    if (raw <= static_cast<float>(std::numeric_limits<T>::lowest())) {
+        return std::numeric_limits<T>::lowest();
+    }
+    if (raw >= static_cast<float>(std::numeric_limits<T>::max())) {
+        return std::numeric_limits<T>::max();
+    }
+    return static_cast<T>(raw);
+}
+#endif // (EI_HAS_YOLO_PRO == 1) || (EI_HAS_YOLOV11 == 1)
+
 #ifdef EI_HAS_YOLO_PRO
+/**
+ * Single pass decoder: detections whose best class score is below the threshold
+ * (compared in the raw output domain) are dropped up front, and boxes are only
+ * dequantized for the remaining (detection, class) pairs.
+ */
 template<typename T>
 __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_common(const ei_impulse_t *impulse,
                                                                                    ei_impulse_result_t *result,
@@ -1762,36 +1861,49 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_comm
     size_t row_count = output_features_count / col_size;
 
     static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    // scratch space, kept between calls so steady state inference does not allocate
+    static std::vector<uint32_t> candidates;
+    static std::vector<float> boxes;
+    static std::vector<float> scores;
+    static std::vector<int> classes;
     results.clear();
+    boxes.clear();
+    scores.clear();
+    classes.clear();
+    candidates.clear();
+
+    const T raw_threshold = ei_yolo_raw_threshold<T>(threshold, zero_point, scale);
+    const float input_width = static_cast<float>(impulse->input_width);
+    const float input_height = static_cast<float>(impulse->input_height);
 
     // (xmin, ymin, xmax, ymax, cls...)
-    for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
+    for (size_t ix = 0; ix < row_count; ix++) {
+        if (ei_yolo_max_score(data + (ix * col_size) + 4, impulse->label_count) >= raw_threshold) {
+            candidates.push_back(ix);
+        }
+    }
 
-        std::vector<float> boxes;
-        std::vector<float> scores;
-        std::vector<int> classes;
-        class_results.clear();
+    for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
+        for (uint32_t ix : candidates) {
+            size_t base_ix = ix * col_size;
+            if (data[base_ix + 4 + cls_idx] < raw_threshold) {
+                continue;
+            }
 
+            float score = (static_cast<float>(data[base_ix + 4 + cls_idx]) - zero_point) * scale;
+            if (score < threshold || score > 1.0f) {
+                continue;
+            }
 
-        for (size_t ix = 0; ix < row_count; ix++) {
-            size_t base_ix = ix * col_size;
             float xmin  = (static_cast<float>(data[base_ix + 0]) - zero_point) * scale;
             float ymin  = (static_cast<float>(data[base_ix + 1]) - zero_point) * scale;
             float xmax  = (static_cast<float>(data[base_ix + 2]) - zero_point) * scale;
             float ymax  = (static_cast<float>(data[base_ix + 3]) - zero_point) * scale;
-            float score = (static_cast<float>(data[base_ix + 4 + cls_idx]) - zero_point) * scale;
 
-            if (xmin < 0) xmin = 0;
-            if (xmin > 1) xmin = 1;
-            if (ymin < 0) ymin = 0;
-            if (ymin > 1) ymin = 1;
-            if (ymax < 0) ymax = 0;
-            if (ymax > 1) ymax = 1;
-            if (xmax < 0) xmax = 0;
-            if (xmax > 1) xmax = 1;
-            if (xmax < xmin) xmax = xmin;
-            if (ymax < ymin) ymax = ymin;
+            xmin = std::min(std::max(xmin, 0.0f), 1.0f);
+            ymin = std::min(std::max(ymin, 0.0f), 1.0f);
+            xmax = std::min(std::max(xmax, xmin), 1.0f);
+            ymax = std::min(std::max(ymax, ymin), 1.0f);
 
             if (debug) {
                 ei_printf("%s (", impulse->categories[(uint32_t)cls_idx]);
@@ -1809,35 +1921,24 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolo_pro_comm
                 ei_printf(" ]\n");
             }
 
-            if (score >= threshold && score <= 1.0f) {
-                ymin *= static_cast<float>(impulse->input_height);
-                xmin *= static_cast<float>(impulse->input_width);
-                ymax *= static_cast<float>(impulse->input_height);
-                xmax *= static_cast<float>(impulse->input_width);
-
-                boxes.push_back(ymin);
-                boxes.push_back(xmin);
-                boxes.push_back(ymax);
-                boxes.push_back(xmax);
-                scores.push_back(score);
-                classes.push_back((int)cls_idx);
-            }
+            boxes.push_back(ymin * input_height);
+            boxes.push_back(xmin * input_width);
+            boxes.push_back(ymax * input_height);
+            boxes.push_back(xmax * input_width);
+            scores.push_back(score);
+            classes.push_back((int)cls_idx);
         }
+    }
 
-        size_t nr_boxes = scores.size();
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &class_results,
-                                              boxes.data(), scores.data(), classes.data(),
-                                              nr_boxes,
-                                              true /*clip_boxes*/,
-                                              debug);
+    // one NMS pass over all classes, boxes only suppress boxes of their own class
+    EI_IMPULSE_ERROR nms_res = ei_run_nms_batched(impulse, &results,
+                                                  boxes.data(), scores.data(), classes.data(),
+                                                  scores.size(),
+                                                  true /*clip_boxes*/,
+                                                  debug);
 
-        if (nms_res != EI_IMPULSE_OK) {
-            return nms_res;
-        }
-
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
+    if (nms_res != EI_IMPULSE_OK) {
+        return nms_res;
     }
 
     prepare_nms_results_common(impulse, result, &results);
@@ -1881,6 +1982,11 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_quantized_yol
 }
 
 #ifdef EI_HAS_YOLOV11
+/**
+ * Single pass decoder: every class row is contiguous, so it is scanned in
+ * blocks against the threshold in the raw output domain, and boxes are only
+ * dequantized for the (detection, class) pairs that survive.
+ */
 template<typename T>
 __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolov11_common(const ei_impulse_t *impulse,
                                                                                    ei_impulse_result_t *result,
@@ -1895,82 +2001,74 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolov11_commo
     size_t col_size = output_features_count / row_count;
 
     static std::vector<ei_impulse_result_bounding_box_t> results;
-    static std::vector<ei_impulse_result_bounding_box_t> class_results;
+    // scratch space, kept between calls so steady state inference does not allocate
+    static std::vector<float> boxes;
+    static std::vector<float> scores;
+    static std::vector<int> classes;
     results.clear();
+    boxes.clear();
+    scores.clear();
+    classes.clear();
+
+    const T raw_threshold = ei_yolo_raw_threshold<T>(threshold, zero_point, scale);
+    const float input_width = static_cast<float>(impulse->input_width);
+    const float input_height = static_cast<float>(impulse->input_height);
+    const float coord_scale_x = is_coord_normalized ? input_width : 1.0f;
+    const float coord_scale_y = is_coord_normalized ? input_height : 1.0f;
 
     // output shape: (num_classes + 4, num_detections) e.g. (5, 189)
     //  [0] -> (xcenter, ycenter, width, height, cls...)
     for (size_t cls_idx = 0; cls_idx < (size_t)impulse->label_count; cls_idx++)  {
-        std::vector<float> boxes;
-        std::vector<float> scores;
-        std::vector<int> classes;
-        class_results.clear();
-
-        for (size_t det_idx = 0; det_idx < col_size; det_idx++) {
-
-            float xcenter = (static_cast<float>(data[0 * col_size + det_idx]) - zero_point) * scale;
-            float ycenter = (static_cast<float>(data[1 * col_size + det_idx]) - zero_point) * scale;
-            float width   = (static_cast<float>(data[2 * col_size + det_idx]) - zero_point) * scale;
-            float height  = (static_cast<float>(data[3 * col_size + det_idx]) - zero_point) * scale;
-
-            // xywh -> xyxy
-            float xmin  = xcenter - (width / 2.0f);
-            float ymin  = ycenter - (height / 2.0f);
-            float xmax  = xcenter + (width / 2.0f);
-            float ymax  = ycenter + (height / 2.0f);
+        const T *cls_scores = data + ((4 + cls_idx) * col_size);
 
-            if (is_coord_normalized) {
-                ymin *= static_cast<float>(impulse->input_height);
-                xmin *= static_cast<float>(impulse->input_width);
-                ymax *= static_cast<float>(impulse->input_height);
-                xmax *= static_cast<float>(impulse->input_width);
-            }
-
-            if (xmin < 0) {
-                xmin = 0;
-            }
-            if (xmin > impulse->input_width) {
-                xmin = impulse->input_width;
-            }
-            if (ymin < 0) {
-                ymin = 0;
-            }
-            if (ymin > impulse->input_height) {
-                ymin = impulse->input_height;
+        for (size_t block = 0; block < col_size; block += EI_CLASSIFIER_YOLO_SCORE_BLOCK_SIZE) {
+            size_t block_end = std::min(block + EI_CLASSIFIER_YOLO_SCORE_BLOCK_SIZE, col_size);
+            if (ei_yolo_max_score(cls_scores + block, block_end - block) < raw_threshold) {
+                continue;
             }
 
-            if (xmax < 0) {
-                xmax = 0;
-            }
-            if (xmax > impulse->input_width) {
-                xmax = impulse->input_width;
-            }
-            if (ymax < 0) {
-                ymax = 0;
-            }
-            if (ymax > impulse->input_height) {
-                ymax = impulse->input_height;
-            }
+            for (size_t det_idx = block; det_idx < block_end; det_idx++) {
+                if (cls_scores[det_idx] < raw_threshold) {
+                    continue;
+                }
 
-            float score = (static_cast<float>(data[(4+cls_idx) * col_size + det_idx]) - zero_point) * scale;
+                float score = (static_cast<float>(cls_scores[det_idx]) - zero_point) * scale;
+                if (score < threshold || score > 1.0f) {
+                    continue;
+                }
 
-            if (debug) {
-                ei_printf("%s (", impulse->categories[(uint32_t)cls_idx]);
-                ei_printf_float(cls_idx);
-                ei_printf("): ");
-                ei_printf_float(score);
-                ei_printf(" [ ");
-                ei_printf_float(xmin);
-                ei_printf(", ");
-                ei_printf_float(ymin);
-                ei_printf(", ");
-                ei_printf_float(xmax);
-                ei_printf(", ");
-                ei_printf_float(ymax);
-                ei_printf(" ]\n");
-            }
+                float xcenter = (static_cast<float>(data[0 * col_size + det_idx]) - zero_point) * scale;
+                float ycenter = (static_cast<float>(data[1 * col_size + det_idx]) - zero_point) * scale;
+                float width   = (static_cast<float>(data[2 * col_size + det_idx]) - zero_point) * scale;
+                float height  = (static_cast<float>(data[3 * col_size + det_idx]) - zero_point) * scale;
+
+                // xywh -> xyxy
+                float xmin  = (xcenter - (width / 2.0f)) * coord_scale_x;
+                float ymin  = (ycenter - (height / 2.0f)) * coord_scale_y;
+                float xmax  = (xcenter + (width / 2.0f)) * coord_scale_x;
+                float ymax  = (ycenter + (height / 2.0f)) * coord_scale_y;
+
+                xmin = std::min(std::max(xmin, 0.0f), input_width);
+                ymin = std::min(std::max(ymin, 0.0f), input_height);
+                xmax = std::min(std::max(xmax, 0.0f), input_width);
+                ymax = std::min(std::max(ymax, 0.0f), input_height);
+
+                if (debug) {
+                    ei_printf("%s (", impulse->categories[(uint32_t)cls_idx]);
+                    ei_printf_float(cls_idx);
+                    ei_printf("): ");
+                    ei_printf_float(score);
+                    ei_printf(" [ ");
+                    ei_printf_float(xmin);
+                    ei_printf(", ");
+                    ei_printf_float(ymin);
+                    ei_printf(", ");
+                    ei_printf_float(xmax);
+                    ei_printf(", ");
+                    ei_printf_float(ymax);
+                    ei_printf(" ]\n");
+                }
 
-            if (score >= threshold && score <= 1.0f) {
                 boxes.push_back(ymin);
                 boxes.push_back(xmin);
                 boxes.push_back(ymax);
@@ -1979,21 +2077,17 @@ __attribute__((unused)) static EI_IMPULSE_ERROR fill_result_struct_yolov11_commo
                 classes.push_back((int)cls_idx);
             }
         }
+    }
 
-        size_t nr_boxes = scores.size();
-        EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, &class_results,
-                                            boxes.data(), scores.data(), classes.data(),
-                                            nr_boxes,
-                                            true /*clip_boxes*/,
-                                            debug);
-
-        if (nms_res != EI_IMPULSE_OK) {
-            return nms_res;
-        }
+    // one NMS pass over all classes, boxes only suppress boxes of their own class
+    EI_IMPULSE_ERROR nms_res = ei_run_nms_batched(impulse, &results,
+                                                  boxes.data(), scores.data(), classes.data(),
+                                                  scores.size(),
+                                                  true /*clip_boxes*/,
+                                                  debug);
 
-        for (auto bb: class_results) {
-            results.push_back(bb);
-        }
+    if (nms_res != EI_IMPULSE_OK) {
+        return nms_res;
     }
 
     prepare_nms_results_common(impulse, result, &results);
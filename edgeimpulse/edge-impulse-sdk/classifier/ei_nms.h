@@ -40,17 +40,11 @@
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 
-#if (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV5) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV5_V5_DRPAI) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOX) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_RETINANET) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_SSD) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_YOLOV3) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_YOLOV4) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV2) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLO_PRO) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV11) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV11_ABS)
-
-// The code below comes from tensorflow/lite/kernels/internal/reference/non_max_suppression.h
-// Copyright 2019 The TensorFlow Authors.  All rights reserved.
-// Licensed under the Apache License, Version 2.0
 #include <algorithm>
-#include <cmath>
-#include <deque>
-#include <queue>
+#include <vector>
 
-// A pair of diagonal corners of the box.
+// A pair of diagonal corners of the box
+// (from tensorflow/lite/kernels/internal/reference/non_max_suppression.h)
 struct BoxCornerEncoding {
   float y1;
   float x1;
@@ -58,166 +52,170 @@ struct BoxCornerEncoding {
   float x2;
 };
 
-static inline float ComputeIntersectionOverUnion(const float* boxes, const int i,
-                                          const int j) {
-  auto& box_i = reinterpret_cast<const BoxCornerEncoding*>(boxes)[i];
-  auto& box_j = reinterpret_cast<const BoxCornerEncoding*>(boxes)[j];
-  const float box_i_y_min = std::min<float>(box_i.y1, box_i.y2);
-  const float box_i_y_max = std::max<float>(box_i.y1, box_i.y2);
-  const float box_i_x_min = std::min<float>(box_i.x1, box_i.x2);
-  const float box_i_x_max = std::max<float>(box_i.x1, box_i.x2);
-  const float box_j_y_min = std::min<float>(box_j.y1, box_j.y2);
-  const float box_j_y_max = std::max<float>(box_j.y1, box_j.y2);
-  const float box_j_x_min = std::min<float>(box_j.x1, box_j.x2);
-  const float box_j_x_max = std::max<float>(box_j.x1, box_j.x2);
-
-  const float area_i =
-      (box_i_y_max - box_i_y_min) * (box_i_x_max - box_i_x_min);
-  const float area_j =
-      (box_j_y_max - box_j_y_min) * (box_j_x_max - box_j_x_min);
-  if (area_i <= 0 || area_j <= 0) return 0.0;
-  const float intersection_ymax = std::min<float>(box_i_y_max, box_j_y_max);
-  const float intersection_xmax = std::min<float>(box_i_x_max, box_j_x_max);
-  const float intersection_ymin = std::max<float>(box_i_y_min, box_j_y_min);
-  const float intersection_xmin = std::max<float>(box_i_x_min, box_j_x_min);
-  const float intersection_area =
-      std::max<float>(intersection_ymax - intersection_ymin, 0.0) *
-      std::max<float>(intersection_xmax - intersection_xmin, 0.0);
-  return intersection_area / (area_i + area_j - intersection_area);
+// The NMS kernel below does not depend on the model, it is also used to merge
+// the detections of several inferences (e.g. tiles of a larger frame).
+
+// Upper bound on the number of candidates that go into ei_nms_sorted() after the
+// score filter; only the highest scoring ones are kept. 0 keeps all candidates.
+#ifndef EI_CLASSIFIER_NMS_MAX_CANDIDATES
+#define EI_CLASSIFIER_NMS_MAX_CANDIDATES 0
+#endif
+
+// Scratch space for ei_nms_sorted(). Boxes are stored as structure of arrays
+// so the IoU loop streams through memory. The buffer is grown on demand and
+// kept between calls.
+typedef struct {
+  size_t capacity;
+  void *buffer;
+  float *y_min;
+  float *x_min;
+  float *y_max;
+  float *x_max;
+  float *area;
+  int *order;
+} ei_nms_workspace_t;
+
+static inline bool ei_nms_workspace_reserve(ei_nms_workspace_t *ws, size_t count) {
+  if (count <= ws->capacity && ws->buffer) {
+    return true;
+  }
+
+  void *buffer = ei_malloc(count * ((5 * sizeof(float)) + sizeof(int)));
+  if (!buffer) {
+    return false;
+  }
+  ei_free(ws->buffer);
+
+  ws->buffer = buffer;
+  ws->capacity = count;
+  ws->y_min = (float *)buffer;
+  ws->x_min = ws->y_min + count;
+  ws->y_max = ws->x_min + count;
+  ws->x_max = ws->y_max + count;
+  ws->area = ws->x_max + count;
+  ws->order = (int *)(ws->area + count);
+  return true;
 }
 
-// Implements (Single-Class) Soft NMS (with Gaussian weighting).
-// Supports functionality of TensorFlow ops NonMaxSuppressionV4 & V5.
-// Reference: "Soft-NMS - Improving Object Detection With One Line of Code"
-//            [Bodla et al, https://arxiv.org/abs/1704.04503]
-// Implementation adapted from the TensorFlow NMS code at
-// tensorflow/core/kernels/non_max_suppression_op.cc.
+// Hard NMS, same selection as tensorflow's reference NonMaxSuppression with
+// soft_nms_sigma == 0, but without a priority queue: candidates above
+// score_threshold are sorted once, then every candidate is compared against
+// the boxes kept so far (most recent first, as overlapping boxes tend to have
+// similar scores). Kept boxes are compacted to the front of the workspace
+// arrays, so the comparison is a linear scan.
 //
 // Arguments:
+//  ws: scratch space, see ei_nms_workspace_t
 //  boxes: box encodings in format [y1, x1, y2, x2], shape: [num_boxes, 4]
-//  num_boxes: number of candidates
 //  scores: scores for candidate boxes, in the same order. shape: [num_boxes]
-//  max_output_size: the maximum number of selections.
-//  iou_threshold: Intersection-over-Union (IoU) threshold for NMS
-//  score_threshold: All candidate scores below this value are rejected
-//  soft_nms_sigma: Soft NMS parameter, used for decaying scores
+//  classes: class of every box, or NULL. When set, candidates are sorted by
+//    class first and only suppressed by boxes of the same class, which gives
+//    the same result as running NMS once per class.
+//  max_output_size: the maximum number of selections (per class if classes is set).
+//  max_candidates: if > 0, only the top max_candidates boxes are considered.
 //
 // Outputs:
-//  selected_indices: all the selected indices. Underlying array must have
-//    length >= max_output_size. Cannot be null.
-//  selected_scores: scores of selected indices. Defer from original value for
-//    Soft NMS. If not null, array must have length >= max_output_size.
-//  num_selected_indices: Number of selections. Only these many elements are
-//    set in selected_indices, selected_scores. Cannot be null.
+//  selected_indices: selected indices, in descending score order (grouped
+//    by class if classes is set). Must have length >= num_boxes.
 //
-// Assumes inputs are valid (for eg, iou_threshold must be >= 0).
-static inline void NonMaxSuppression(const float* boxes, const int num_boxes,
-                              const float* scores, const int max_output_size,
-                              const float iou_threshold,
-                              const float score_threshold,
-                              const float soft_nms_sigma, int* selected_indices,
-                              float* selected_scores,
-                              int* num_selected_indices) {
-  struct Candidate {
-    int index;
-    float score;
-    int suppress_begin_index;
-  };
+// Returns the number of selected boxes, or -1 if the workspace could not be
+// allocated.
+static inline int ei_nms_sorted(ei_nms_workspace_t *ws,
+                                const float *boxes, const int num_boxes,
+                                const float *scores, const int *classes,
+                                const int max_output_size,
+                                const int max_candidates,
+                                const float iou_threshold,
+                                const float score_threshold,
+                                int *selected_indices) {
+  if (!ei_nms_workspace_reserve(ws, (size_t)num_boxes)) {
+    return -1;
+  }
 
-  // Priority queue to hold candidates.
-  auto cmp = [](const Candidate bs_i, const Candidate bs_j) {
-    return bs_i.score < bs_j.score;
-  };
-  std::priority_queue<Candidate, std::deque<Candidate>, decltype(cmp)>
-      candidate_priority_queue(cmp);
-  // Populate queue with candidates above the score threshold.
+  int n = 0;
   for (int i = 0; i < num_boxes; ++i) {
     if (scores[i] > score_threshold) {
-      candidate_priority_queue.emplace(Candidate({i, scores[i], 0}));
+      ws->order[n++] = i;
     }
   }
 
-  *num_selected_indices = 0;
-  int num_outputs = std::min(static_cast<int>(candidate_priority_queue.size()),
-                             max_output_size);
-  if (num_outputs == 0) return;
-
-  // NMS loop.
-  float scale = 0;
-  if (soft_nms_sigma > 0.0) {
-    scale = -0.5 / soft_nms_sigma;
+  if (max_candidates > 0 && n > max_candidates) {
+    auto by_score = [scores](const int lhs, const int rhs) {
+      return (scores[lhs] > scores[rhs]) || (scores[lhs] == scores[rhs] && lhs < rhs);
+    };
+    std::partial_sort(ws->order, ws->order + max_candidates, ws->order + n, by_score);
+    n = max_candidates;
   }
-  while (*num_selected_indices < num_outputs &&
-         !candidate_priority_queue.empty()) {
-    Candidate next_candidate = candidate_priority_queue.top();
-    const float original_score = next_candidate.score;
-    candidate_priority_queue.pop();
-
-    // Overlapping boxes are likely to have similar scores, therefore we
-    // iterate through the previously selected boxes backwards in order to
-    // see if `next_candidate` should be suppressed. We also enforce a property
-    // that a candidate can be suppressed by another candidate no more than
-    // once via `suppress_begin_index` which tracks which previously selected
-    // boxes have already been compared against next_candidate prior to a given
-    // iteration.  These previous selected boxes are then skipped over in the
-    // following loop.
-    bool should_hard_suppress = false;
-    for (int j = *num_selected_indices - 1;
-         j >= next_candidate.suppress_begin_index; --j) {
-      const float iou = ComputeIntersectionOverUnion(
-          boxes, next_candidate.index, selected_indices[j]);
-
-      // First decide whether to perform hard suppression.
-      if (iou >= iou_threshold) {
-        should_hard_suppress = true;
-        break;
-      }
 
-      // Suppress score if NMS sigma > 0.
-      if (soft_nms_sigma > 0.0) {
-        next_candidate.score =
-            next_candidate.score * std::exp(scale * iou * iou);
-      }
+  // ties are broken on index, so the output does not depend on the sort
+  auto cmp = [scores, classes](const int lhs, const int rhs) {
+    if (classes && classes[lhs] != classes[rhs]) {
+      return classes[lhs] < classes[rhs];
+    }
+    return (scores[lhs] > scores[rhs]) || (scores[lhs] == scores[rhs] && lhs < rhs);
+  };
+  std::sort(ws->order, ws->order + n, cmp);
+
+  auto box = reinterpret_cast<const BoxCornerEncoding*>(boxes);
+  int num_selected = 0;
+  int class_begin = 0;
+  int class_selected = 0;
 
-      // If score has fallen below score_threshold, it won't be pushed back into
-      // the queue.
-      if (next_candidate.score <= score_threshold) break;
+  for (int k = 0; k < n; ++k) {
+    const int index = ws->order[k];
+
+    if (classes && k > 0 && classes[index] != classes[ws->order[k - 1]]) {
+      class_begin = num_selected;
+      class_selected = 0;
+    }
+    if (class_selected >= max_output_size) {
+      continue;
     }
-    // If `next_candidate.score` has not dropped below `score_threshold`
-    // by this point, then we know that we went through all of the previous
-    // selections and can safely update `suppress_begin_index` to
-    // `selected.size()`. If on the other hand `next_candidate.score`
-    // *has* dropped below the score threshold, then since `suppress_weight`
-    // always returns values in [0, 1], further suppression by items that were
-    // not covered in the above for loop would not have caused the algorithm
-    // to select this item. We thus do the same update to
-    // `suppress_begin_index`, but really, this element will not be added back
-    // into the priority queue.
-    next_candidate.suppress_begin_index = *num_selected_indices;
-
-    if (!should_hard_suppress) {
-      if (next_candidate.score == original_score) {
-        // Suppression has not occurred, so select next_candidate.
-        selected_indices[*num_selected_indices] = next_candidate.index;
-        if (selected_scores) {
-          selected_scores[*num_selected_indices] = next_candidate.score;
+
+    const BoxCornerEncoding &b = box[index];
+    const float y_min = std::min<float>(b.y1, b.y2);
+    const float y_max = std::max<float>(b.y1, b.y2);
+    const float x_min = std::min<float>(b.x1, b.x2);
+    const float x_max = std::max<float>(b.x1, b.x2);
+    const float area = (y_max - y_min) * (x_max - x_min);
+
+    // boxes without area never overlap anything
+    bool suppressed = false;
+    if (area > 0) {
+      for (int j = num_selected - 1; j >= class_begin; --j) {
+        if (ws->area[j] <= 0) {
+          continue;
+        }
+        const float intersection_area =
+            std::max<float>(std::min<float>(y_max, ws->y_max[j]) - std::max<float>(y_min, ws->y_min[j]), 0.0) *
+            std::max<float>(std::min<float>(x_max, ws->x_max[j]) - std::max<float>(x_min, ws->x_min[j]), 0.0);
+        const float iou = intersection_area / (area + ws->area[j] - intersection_area);
+        if (iou >= iou_threshold) {
+          suppressed = true;
+          break;
         }
-        ++*num_selected_indices;
-      }
-      if ((soft_nms_sigma > 0.0) && (next_candidate.score > score_threshold)) {
-        // Soft suppression might have occurred and current score is still
-        // greater than score_threshold; add next_candidate back onto priority
-        // queue.
-        candidate_priority_queue.push(next_candidate);
       }
     }
+    if (suppressed) {
+      continue;
+    }
+
+    // num_selected <= k, so this never overwrites a candidate that is still to be read
+    ws->y_min[num_selected] = y_min;
+    ws->x_min[num_selected] = x_min;
+    ws->y_max[num_selected] = y_max;
+    ws->x_max[num_selected] = x_max;
+    ws->area[num_selected] = area;
+    selected_indices[num_selected++] = index;
+    class_selected++;
   }
+
+  return num_selected;
 }
 
-/**
- * Run non-max suppression over the results array (for bounding boxes)
- */
-EI_IMPULSE_ERROR ei_run_nms(
+#if (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV5) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV5_V5_DRPAI) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOX) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_RETINANET) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_SSD) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_YOLOV3) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_TAO_YOLOV4) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV2) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLO_PRO) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV11) || (EI_CLASSIFIER_OBJECT_DETECTION_LAST_LAYER == EI_CLASSIFIER_LAST_LAYER_YOLOV11_ABS)
+
+static EI_IMPULSE_ERROR ei_run_nms_common(
     const ei_impulse_t *impulse,
     std::vector<ei_impulse_result_bounding_box_t> *results,
     float *boxes,
@@ -225,51 +223,46 @@ EI_IMPULSE_ERROR ei_run_nms(
     int *classes,
     size_t bb_count,
     bool clip_boxes,
+    bool per_class,
     bool debug) {
 
+    static ei_nms_workspace_t nms_workspace = { 0 };
+    static std::vector<int> selected_indices;
+
     if (bb_count < 1) {
         return EI_IMPULSE_OK;
     }
 
-    int *selected_indices = (int*)ei_malloc(1 * bb_count * sizeof(int));
-    float *selected_scores = (float*)ei_malloc(1 * bb_count * sizeof(float));
-
-    if (!scores || !boxes || !selected_indices || !selected_scores || !classes) {
-        ei_free(selected_indices);
-        ei_free(selected_scores);
+    if (!scores || !boxes || !classes) {
         return EI_IMPULSE_OUT_OF_MEMORY;
     }
 
-    //  boxes: box encodings in format [y1, x1, y2, x2], shape: [num_boxes, 4]
-    //  num_boxes: number of candidates
-    //  scores: scores for candidate boxes, in the same order. shape: [num_boxes]
-    //  max_output_size: the maximum number of selections.
-    //  iou_threshold: Intersection-over-Union (IoU) threshold for NMS
-    //  score_threshold: All candidate scores below this value are rejected
-    //  soft_nms_sigma: Soft NMS parameter, used for decaying scores
-
-    int num_selected_indices;
+    selected_indices.resize(bb_count);
 
-    NonMaxSuppression(
+    int num_selected_indices = ei_nms_sorted(
+        &nms_workspace,
         (const float*)boxes, // boxes
         bb_count, // num_boxes
         (const float*)scores, // scores
+        per_class ? classes : NULL, // classes
         bb_count, // max_output_size
+        EI_CLASSIFIER_NMS_MAX_CANDIDATES, // max_candidates
         impulse->object_detection_nms.iou_threshold, // iou_threshold
         impulse->object_detection_nms.confidence_threshold, // score_threshold
-        0.0f, // soft_nms_sigma
-        selected_indices,
-        selected_scores,
-        &num_selected_indices);
+        selected_indices.data());
 
-    std::vector<ei_impulse_result_bounding_box_t> new_results;
+    if (num_selected_indices < 0) {
+        return EI_IMPULSE_OUT_OF_MEMORY;
+    }
+
+    results->clear();
 
     for (size_t ix = 0; ix < (size_t)num_selected_indices; ix++) {
 
         int out_ix = selected_indices[ix];
         ei_impulse_result_bounding_box_t bb;
         bb.label  = impulse->categories[classes[out_ix]];
-        bb.value  = selected_scores[ix];
+        bb.value  = scores[out_ix];
 
         float ymin = boxes[(out_ix * 4) + 0];
         float xmin = boxes[(out_ix * 4) + 1];
@@ -287,7 +280,7 @@ EI_IMPULSE_ERROR ei_run_nms(
         bb.x      = static_cast<uint32_t>(xmin);
         bb.height = static_cast<uint32_t>(ymax) - bb.y;
         bb.width  = static_cast<uint32_t>(xmax) - bb.x;
-        new_results.push_back(bb);
+        results->push_back(bb);
 
         if (debug) {
           ei_printf("Found bb with label %s\n", bb.label);
@@ -295,17 +288,44 @@ EI_IMPULSE_ERROR ei_run_nms(
 
     }
 
-    results->clear();
+    return EI_IMPULSE_OK;
 
-    for (size_t ix = 0; ix < new_results.size(); ix++) {
-        results->push_back(new_results[ix]);
-    }
+}
 
-    ei_free(selected_indices);
-    ei_free(selected_scores);
+/**
+ * Run non-max suppression over the results array (for bounding boxes)
+ */
+EI_IMPULSE_ERROR ei_run_nms(
+    const ei_impulse_t *impulse,
+    std::vector<ei_impulse_result_bounding_box_t> *results,
+    float *boxes,
+    float *scores,
+    int *classes,
+    size_t bb_count,
+    bool clip_boxes,
+    bool debug) {
 
-    return EI_IMPULSE_OK;
+    return ei_run_nms_common(impulse, results, boxes, scores, classes, bb_count,
+                             clip_boxes, false /*per_class*/, debug);
+}
 
+/**
+ * Run non-max suppression for all classes in one call. Boxes only suppress
+ * boxes of the same class, results are the same as calling ei_run_nms()
+ * once per class and concatenating the results in class order.
+ */
+EI_IMPULSE_ERROR ei_run_nms_batched(
+    const ei_impulse_t *impulse,
+    std::vector<ei_impulse_result_bounding_box_t> *results,
+    float *boxes,
+    float *scores,
+    int *classes,
+    size_t bb_count,
+    bool clip_boxes,
+    bool debug) {
+
+    return ei_run_nms_common(impulse, results, boxes, scores, classes, bb_count,
+                             clip_boxes, true /*per_class*/, debug);
 }
 
 /**
@@ -330,16 +350,13 @@ EI_IMPULSE_ERROR ei_run_nms(
         return EI_IMPULSE_OK;
     }
 
-    float *boxes = (float*)ei_malloc(4 * bb_count * sizeof(float));
-    float *scores = (float*)ei_malloc(1 * bb_count * sizeof(float));
-    int *classes = (int*) ei_malloc(bb_count * sizeof(int));
-
-    if (!scores || !boxes || !classes) {
-        ei_free(boxes);
-        ei_free(scores);
-        ei_free(classes);
-        return EI_IMPULSE_OUT_OF_MEMORY;
-    }
+    // kept between calls, so steady state inference does not allocate
+    static std::vector<float> boxes;
+    static std::vector<float> scores;
+    static std::vector<int> classes;
+    boxes.resize(4 * bb_count);
+    scores.resize(bb_count);
+    classes.resize(bb_count);
 
     size_t box_ix = 0;
     for (size_t ix = 0; ix < results->size(); ix++) {
@@ -361,18 +378,11 @@ EI_IMPULSE_ERROR ei_run_nms(
         box_ix++;
     }
 
-    EI_IMPULSE_ERROR nms_res = ei_run_nms(impulse, results,
-                                          boxes, scores,
-                                          classes, bb_count,
-                                          clip_boxes,
-                                          debug);
-
-
-    ei_free(boxes);
-    ei_free(scores);
-    ei_free(classes);
-
-    return nms_res;
+    return ei_run_nms(impulse, results,
+                      boxes.data(), scores.data(),
+                      classes.data(), bb_count,
+                      clip_boxes,
+                      debug);
 
 }
 
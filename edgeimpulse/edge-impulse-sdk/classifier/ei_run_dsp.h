@@ -1233,20 +1233,214 @@ __attribute__((unused)) int extract_drpai_features_quantized(signal_t *signal, m
 
 #if (EI_CLASSIFIER_QUANTIZATION_ENABLED == 1) && (EI_CLASSIFIER_INFERENCING_ENGINE != EI_CLASSIFIER_DRPAI)
 
+/**
+ * Lookup tables for extract_image_features_quantized. With a fixed scale, zero point and
+ * image scaling every channel byte always maps to the same output, so the float normalisation
+ * runs 3 x 256 times when the model parameters change instead of once per pixel.
+ */
+typedef struct {
+    bool valid;
+    int16_t channel_count;
+    float scale;
+    float zero_point;
+    int image_scaling;
+    // rgb holds uint8 values (stored as their bytes) for UINT8 model inputs
+    bool output_uint8;
+    // source channel feeding each output channel (BGR models swap R and B)
+    uint8_t src_channel[3];
+    union {
+        // quantised value, indexed by output channel and source byte
+        int8_t rgb[3][256];
+        // luma weighted, normalised value, indexed by source channel and source byte
+        float gray[3][256];
+    };
+} ei_image_quant_lut_t;
+
+/**
+ * Normalise one channel value the way the model was trained,
+ * out_channel selects the per channel mean / std
+ */
+__attribute__((unused)) static float ei_image_normalize_channel(float v, int out_channel, int image_scaling) {
+    static const float torch_mean[] = { 0.485, 0.456, 0.406 };
+    static const float torch_std[] = { 0.229, 0.224, 0.225 };
+    static const float tao_mean[] = { 103.939, 116.779, 123.68 };
+
+    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+        v /= 255.0f;
+    }
+    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
+        v /= 255.0f;
+        v = (v - torch_mean[out_channel]) / torch_std[out_channel];
+    }
+    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
+        v -= 128.0f;
+    }
+    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN1_1) {
+        v /= 255.0f;
+        v = v * 2.0f - 1.0f;
+    }
+    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_BGR_SUBTRACT_IMAGENET_MEAN) {
+        v -= tao_mean[out_channel];
+    }
+    // EI_CLASSIFIER_IMAGE_SCALING_0_255 keeps the raw value
+
+    return v;
+}
+
+/**
+ * Quantise a normalised value, saturated to the range of the output type. uint8 values are
+ * returned as their bytes.
+ */
+__attribute__((unused)) static int8_t ei_image_quantize_value(float v, float scale, float zero_point, bool output_uint8) {
+    float q = round(v / scale) + zero_point;
+
+    if (output_uint8) {
+        if (q < 0.0f) q = 0.0f;
+        else if (q > 255.0f) q = 255.0f;
+        return static_cast<int8_t>(static_cast<uint8_t>(static_cast<int32_t>(q)));
+    }
+
+    if (q < -128.0f) q = -128.0f;
+    else if (q > 127.0f) q = 127.0f;
+    return static_cast<int8_t>(static_cast<int32_t>(q));
+}
+
+/**
+ * Get the lookup tables for the given model parameters, they are only rebuilt
+ * when another model (or block) with different parameters runs
+ */
+__attribute__((unused)) static const ei_image_quant_lut_t *ei_image_quant_lut_get(int16_t channel_count, float scale, float zero_point, int image_scaling, bool output_uint8 = false) {
+    static ei_image_quant_lut_t lut;
+
+    if (lut.valid && lut.channel_count == channel_count && lut.scale == scale &&
+        lut.zero_point == zero_point && lut.image_scaling == image_scaling &&
+        lut.output_uint8 == output_uint8) {
+        return &lut;
+    }
+
+    const bool bgr = image_scaling == EI_CLASSIFIER_IMAGE_SCALING_BGR_SUBTRACT_IMAGENET_MEAN;
+    lut.src_channel[0] = bgr ? 2 : 0;
+    lut.src_channel[1] = 1;
+    lut.src_channel[2] = bgr ? 0 : 2;
+
+    if (channel_count == 3) {
+        for (int c = 0; c < 3; c++) {
+            for (int v = 0; v < 256; v++) {
+                float n = ei_image_normalize_channel(static_cast<float>(v), c, image_scaling);
+                lut.rgb[c][v] = ei_image_quantize_value(n, scale, zero_point, output_uint8);
+            }
+        }
+    }
+    else {
+        // ITU-R 601-2 luma transform
+        // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
+        static const float luma[] = { 0.299f, 0.587f, 0.114f };
+
+        for (int c = 0; c < 3; c++) {
+            for (int v = 0; v < 256; v++) {
+                float n = ei_image_normalize_channel(static_cast<float>(v), lut.src_channel[c], image_scaling);
+                lut.gray[c][v] = luma[c] * n;
+            }
+        }
+    }
+
+    lut.channel_count = channel_count;
+    lut.scale = scale;
+    lut.zero_point = zero_point;
+    lut.image_scaling = image_scaling;
+    lut.output_uint8 = output_uint8;
+    lut.valid = true;
+
+    return &lut;
+}
+
+/**
+ * Quantise a row of pixels into RGB model input. step is the number of bytes per source
+ * pixel, 3 for RGB888 or 1 for a grayscale source (which feeds all three channels).
+ * With step 3, src and dst may be the same buffer.
+ */
+__attribute__((unused)) static void ei_quantize_row_rgb(const uint8_t *src, size_t step, size_t pixels, int8_t *dst, const ei_image_quant_lut_t *lut) {
+    const int8_t *lut_0 = lut->rgb[0];
+    const int8_t *lut_1 = lut->rgb[1];
+    const int8_t *lut_2 = lut->rgb[2];
+    const size_t src_0 = step == 3 ? lut->src_channel[0] : 0;
+    const size_t src_1 = step == 3 ? lut->src_channel[1] : 0;
+    const size_t src_2 = step == 3 ? lut->src_channel[2] : 0;
+
+    for (size_t ix = 0; ix < pixels; ix++, src += step, dst += 3) {
+        const uint8_t s0 = src[src_0];
+        const uint8_t s1 = src[src_1];
+        const uint8_t s2 = src[src_2];
+        dst[0] = lut_0[s0];
+        dst[1] = lut_1[s1];
+        dst[2] = lut_2[s2];
+    }
+}
+
+/**
+ * Quantise a row of pixels into grayscale model input, see ei_quantize_row_rgb for step
+ */
+__attribute__((unused)) static void ei_quantize_row_gray(const uint8_t *src, size_t step, size_t pixels, int8_t *dst, const ei_image_quant_lut_t *lut) {
+    const size_t g_ix = step == 3 ? 1 : 0;
+    const size_t b_ix = step == 3 ? 2 : 0;
+
+    // integer path for the default input quantisation
+    if (lut->scale == 0.003921568859368563f && lut->zero_point == -128 && lut->image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
+        const int32_t iRedToGray = (int32_t)(0.299f * 65536.0f);
+        const int32_t iGreenToGray = (int32_t)(0.587f * 65536.0f);
+        const int32_t iBlueToGray = (int32_t)(0.114f * 65536.0f);
+
+        for (size_t ix = 0; ix < pixels; ix++, src += step) {
+            int32_t gray = (iRedToGray * src[0]) + (iGreenToGray * src[g_ix]) + (iBlueToGray * src[b_ix]);
+            gray >>= 16; // scale down to int8_t
+            gray += -128;
+            if (gray < - 128) gray = -128;
+            else if (gray > 127) gray = 127;
+            *dst++ = static_cast<int8_t>(gray);
+        }
+        return;
+    }
+
+    const float *lut_r = lut->gray[0];
+    const float *lut_g = lut->gray[1];
+    const float *lut_b = lut->gray[2];
+    const float scale = lut->scale;
+    const float zero_point = lut->zero_point;
+
+    for (size_t ix = 0; ix < pixels; ix++, src += step) {
+        float v = lut_r[src[0]] + lut_g[src[g_ix]] + lut_b[src[b_ix]];
+        *dst++ = ei_image_quantize_value(v, scale, zero_point, false);
+    }
+}
+
 __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, matrix_i8_t *output_matrix, void *config_ptr, float scale, float zero_point, const float frequency,
                                                              int image_scaling) {
     ei_dsp_config_image_t config = *((ei_dsp_config_image_t*)config_ptr);
 
     int16_t channel_count = strcmp(config.channels, "Grayscale") == 0 ? 1 : 3;
 
-    size_t output_ix = 0;
+    const ei_image_quant_lut_t *lut = ei_image_quant_lut_get(channel_count, scale, zero_point, image_scaling);
 
-    const int32_t iRedToGray = (int32_t)(0.299f * 65536.0f);
-    const int32_t iGreenToGray = (int32_t)(0.587f * 65536.0f);
-    const int32_t iBlueToGray = (int32_t)(0.114f * 65536.0f);
+    int8_t *out_ptr = output_matrix->buffer;
 
-    static const float torch_mean[] = { 0.485, 0.456, 0.406 };
-    static const float torch_std[] = { 0.229, 0.224, 0.225 };
+    // byte-typed frame buffer, read the pixels in place
+    const image_view_t *image = signal->image;
+    if (image && image->data && (size_t)image->width * image->height == signal->total_length) {
+        const size_t step = image->format == EI_IMAGE_FORMAT_RGB888 ? 3 : 1;
+
+        for (uint32_t y = 0; y < image->height; y++) {
+            const uint8_t *row = image->data + (size_t)y * image->stride;
+
+            if (channel_count == 3) {
+                ei_quantize_row_rgb(row, step, image->width, out_ptr, lut);
+            }
+            else {
+                ei_quantize_row_gray(row, step, image->width, out_ptr, lut);
+            }
+            out_ptr += image->width * channel_count;
+        }
+        return EIDSP_OK;
+    }
 
 #if defined(EI_DSP_IMAGE_BUFFER_STATIC_SIZE)
     const size_t page_size = EI_DSP_IMAGE_BUFFER_STATIC_SIZE;
@@ -1269,99 +1463,27 @@ __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, m
         }
         signal->get_data(ix, elements_to_read, input_matrix.buffer);
 
-        for (size_t jx = 0; jx < elements_to_read; jx++) {
-            uint32_t pixel = static_cast<uint32_t>(input_matrix.buffer[jx]);
+        // unpack the packed float pixels a few at a time and run them through the row kernels
+        const size_t chunk_size = 64;
+        uint8_t chunk[chunk_size * 3];
+
+        for (size_t jx = 0; jx < elements_to_read; jx += chunk_size) {
+            size_t pixels = elements_to_read - jx > chunk_size ? chunk_size : elements_to_read - jx;
+
+            for (size_t kx = 0; kx < pixels; kx++) {
+                uint32_t pixel = static_cast<uint32_t>(input_matrix.buffer[jx + kx]);
+                chunk[kx * 3 + 0] = pixel >> 16 & 0xff;
+                chunk[kx * 3 + 1] = pixel >> 8 & 0xff;
+                chunk[kx * 3 + 2] = pixel & 0xff;
+            }
 
             if (channel_count == 3) {
-                // fast code path
-                if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                    int32_t r = static_cast<int32_t>(pixel >> 16 & 0xff);
-                    int32_t g = static_cast<int32_t>(pixel >> 8 & 0xff);
-                    int32_t b = static_cast<int32_t>(pixel & 0xff);
-
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(r + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(g + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(b + zero_point);
-                }
-                // slow code path
-                else {
-                    float r = static_cast<float>(pixel >> 16 & 0xff);
-                    float g = static_cast<float>(pixel >> 8 & 0xff);
-                    float b = static_cast<float>(pixel & 0xff);
-
-                    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-
-                        r = (r - torch_mean[0]) / torch_std[0];
-                        g = (g - torch_mean[1]) / torch_std[1];
-                        b = (b - torch_mean[2]) / torch_std[2];
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
-                        r -= 128.0f;
-                        g -= 128.0f;
-                        b -= 128.0f;
-                    }
-
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(r / scale) + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(g / scale) + zero_point);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(b / scale) + zero_point);
-                }
+                ei_quantize_row_rgb(chunk, 3, pixels, out_ptr, lut);
             }
             else {
-                // fast code path
-                if (scale == 0.003921568859368563f && zero_point == -128 && image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                    int32_t r = static_cast<int32_t>(pixel >> 16 & 0xff);
-                    int32_t g = static_cast<int32_t>(pixel >> 8 & 0xff);
-                    int32_t b = static_cast<int32_t>(pixel & 0xff);
-
-                    // ITU-R 601-2 luma transform
-                    // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
-                    int32_t gray = (iRedToGray * r) + (iGreenToGray * g) + (iBlueToGray * b);
-                    gray >>= 16; // scale down to int8_t
-                    gray += zero_point;
-                    if (gray < - 128) gray = -128;
-                    else if (gray > 127) gray = 127;
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(gray);
-                }
-                // slow code path
-                else {
-                    float r = static_cast<float>(pixel >> 16 & 0xff);
-                    float g = static_cast<float>(pixel >> 8 & 0xff);
-                    float b = static_cast<float>(pixel & 0xff);
-
-                    if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_NONE) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_TORCH) {
-                        r /= 255.0f;
-                        g /= 255.0f;
-                        b /= 255.0f;
-
-                        r = (r - torch_mean[0]) / torch_std[0];
-                        g = (g - torch_mean[1]) / torch_std[1];
-                        b = (b - torch_mean[2]) / torch_std[2];
-                    }
-                    else if (image_scaling == EI_CLASSIFIER_IMAGE_SCALING_MIN128_127) {
-                        r -= 128.0f;
-                        g -= 128.0f;
-                        b -= 128.0f;
-                    }
-
-                    // ITU-R 601-2 luma transform
-                    // see: https://pillow.readthedocs.io/en/stable/reference/Image.html#PIL.Image.Image.convert
-                    float v = (0.299f * r) + (0.587f * g) + (0.114f * b);
-                    output_matrix->buffer[output_ix++] = static_cast<int8_t>(round(v / scale) + zero_point);
-                }
+                ei_quantize_row_gray(chunk, 3, pixels, out_ptr, lut);
             }
+            out_ptr += pixels * channel_count;
         }
 
         bytes_left -= elements_to_read;
@@ -41,79 +41,595 @@
 #include "edge-impulse-sdk/classifier/ei_fill_result_struct.h"
 #include "edge-impulse-sdk/classifier/ei_model_types.h"
 #include "edge-impulse-sdk/classifier/ei_run_dsp.h"
+#include "edge-impulse-sdk/classifier/ei_quantize.h"
 #include "edge-impulse-sdk/porting/ei_logging.h"
 
 #include "ll_aton_runtime.h"
 #include "app_config.h"
 
-/* Private variables ------------------------------------------------------- */
-static uint8_t *nn_in;
-static uint8_t *nn_out;
+// pipelined inference runs the NPU from a thread of its own
+#if (LL_ATON_OSAL == LL_ATON_OSAL_THREADX)
+#include "tx_api.h"
+#define EI_ATON_PIPELINE_SUPPORTED  1
+#else
+#define EI_ATON_PIPELINE_SUPPORTED  0
+#endif
+
+/* Private types ----------------------------------------------------------- */
+#ifndef EI_ATON_MAX_NETWORKS
+#define EI_ATON_MAX_NETWORKS        4
+#endif
+
+// bytes of NPU input staged (and cleaned from the D-cache) at a time, half the D-cache
+#ifndef EI_ATON_STAGE_STRIPE_BYTES
+#define EI_ATON_STAGE_STRIPE_BYTES  16384
+#endif
 
-static const LL_Buffer_InfoTypeDef *nn_in_info;
-static const LL_Buffer_InfoTypeDef *nn_out_info;
+#ifndef EI_ATON_NPU_THREAD_STACK_SIZE
+#define EI_ATON_NPU_THREAD_STACK_SIZE   4096
+#endif
+
+/**
+ * An NPU network bound to an impulse, with its own buffer info and execution state
+ * (held by the NN instance), so several compiled networks can be run one after the other
+ */
+typedef struct {
+    const ei_impulse_t *impulse;            // nullptr for the default network
+    uint32_t learn_block_index;             // learning block of the impulse run by the network
+    NN_Instance_TypeDef *instance;
+    const LL_Buffer_InfoTypeDef *in_info;
+    const LL_Buffer_InfoTypeDef *out_info;
+    uint8_t *nn_in;
+    bool initialized;
+} ei_aton_network_t;
 
+/* Private variables ------------------------------------------------------- */
 LL_ATON_DECLARE_NAMED_NN_INSTANCE_AND_INTERFACE(Default);
 
+// the first entry is the network compiled as "Default", used by every impulse without a binding
+static ei_aton_network_t aton_networks[EI_ATON_MAX_NETWORKS] = { { nullptr, 0, &NN_Instance_Default } };
+static size_t aton_networks_count = 1;
+static bool aton_runtime_initialized = false;
+static TraceEpochBlock_FuncPtr_t aton_epoch_callback = NULL;
 
-EI_IMPULSE_ERROR run_nn_inference_image_quantized(
+/**
+ * Pipelined inference: the NPU runs a frame on its own thread while the caller decodes the
+ * previous frame, from a copy of the outputs taken when the NPU was done with it
+ */
+typedef struct {
+    bool enabled;
+    bool has_result;                        // the last inference decoded a frame
+    ei_aton_network_t *busy;                // network running on the NPU, nullptr when idle
+    const ei_impulse_t *busy_impulse;
+    ei_aton_network_t *pending;             // network whose outputs are in out_copy, not decoded yet
+    const ei_impulse_t *pending_impulse;
+    uint8_t *out_copy;
+    size_t out_copy_size;
+} ei_aton_pipeline_t;
+
+static ei_aton_pipeline_t aton_pipeline = { false, false, nullptr, nullptr, nullptr, nullptr, nullptr, 0 };
+
+#if EI_ATON_PIPELINE_SUPPORTED
+static TX_THREAD aton_npu_thread;
+static TX_SEMAPHORE aton_npu_start;
+static TX_SEMAPHORE aton_npu_done;
+static bool aton_npu_thread_created = false;
+__attribute__((aligned(8)))
+static uint8_t aton_npu_thread_stack[EI_ATON_NPU_THREAD_STACK_SIZE];
+#endif
+
+static void ei_aton_pipeline_wait(void);
+
+/**
+ * @brief      Bind a compiled network to an impulse. Networks other than the default one
+ *             are compiled with their own --network-name and declared in the application with
+ *             LL_ATON_DECLARE_NAMED_NN_INSTANCE_AND_INTERFACE(name), then bound before the
+ *             first inference of the impulse: ei_aton_bind_network(&impulse, &NN_Instance_name).
+ *             Impulses with more than one learning block (e.g. visual anomaly, where the GMM
+ *             follows the feature extractor) bind one network per block.
+ *
+ * @param[in]  impulse            The impulse, nullptr rebinds the default network
+ * @param[in]  instance           NN instance of the network
+ * @param[in]  learn_block_index  Learning block run by the network
+ *
+ * @return     false if EI_ATON_MAX_NETWORKS networks are already bound
+ */
+bool ei_aton_bind_network(const ei_impulse_t *impulse, NN_Instance_TypeDef *instance, uint32_t learn_block_index = 0)
+{
+    size_t ix = 0;
+
+    ei_aton_pipeline_wait();
+
+    while (ix < aton_networks_count &&
+           (aton_networks[ix].impulse != impulse || aton_networks[ix].learn_block_index != learn_block_index)) {
+        ix++;
+    }
+
+    if (ix == aton_networks_count) {
+        if (aton_networks_count == EI_ATON_MAX_NETWORKS) {
+            EI_LOGE("Can't bind NPU network %s, increase EI_ATON_MAX_NETWORKS\n", instance->network->network_name);
+            return false;
+        }
+        aton_networks_count++;
+    }
+    else if (aton_networks[ix].instance != instance && aton_networks[ix].initialized) {
+        LL_ATON_RT_DeInit_Network(aton_networks[ix].instance);
+    }
+
+    aton_networks[ix].impulse = impulse;
+    aton_networks[ix].learn_block_index = learn_block_index;
+    aton_networks[ix].instance = instance;
+    aton_networks[ix].initialized = false;
+
+    return true;
+}
+
+/**
+ * @brief      Get the network bound to a learning block of an impulse (or the default one
+ *             for the first block), initialising the runtime and the network on first use
+ *
+ * @param[in]  impulse            The impulse, nullptr for the default network
+ * @param[in]  learn_block_index  Learning block of the impulse
+ *
+ * @return     The network, nullptr if no network is bound to a later learning block
+ */
+static ei_aton_network_t *ei_aton_get_network(const ei_impulse_t *impulse, uint32_t learn_block_index = 0)
+{
+    ei_aton_network_t *net = learn_block_index == 0 ? &aton_networks[0] : nullptr;
+
+    for (size_t ix = 1; ix < aton_networks_count; ix++) {
+        if (aton_networks[ix].impulse == impulse && aton_networks[ix].learn_block_index == learn_block_index) {
+            net = &aton_networks[ix];
+            break;
+        }
+    }
+
+    if (net == nullptr) {
+        EI_LOGE("No NPU network bound to learning block %u\n", (unsigned)learn_block_index);
+        return nullptr;
+    }
+
+    if (!net->initialized) {
+        net->in_info = net->instance->network->input_buffers_info();
+        net->out_info = net->instance->network->output_buffers_info();
+        net->nn_in = (uint8_t *) LL_Buffer_addr_start(&net->in_info[0]);
+
+        // runtime and networks are initialised once and kept alive between inferences
+        if (!aton_runtime_initialized) {
+            LL_ATON_RT_RuntimeInit();
+            aton_runtime_initialized = true;
+        }
+        LL_ATON_RT_SetEpochCallback(aton_epoch_callback, net->instance);
+        LL_ATON_RT_Init_Network(net->instance);
+
+        net->initialized = true;
+    }
+
+    return net;
+}
+
+/**
+ * @brief      Check that a network was bound to a learning block of an impulse with
+ *             ei_aton_bind_network. Unlike ei_aton_get_network, the default network doesn't
+ *             count, so a second impulse doesn't silently run the first one's network
+ *
+ * @param[in]  impulse            The impulse
+ * @param[in]  learn_block_index  Learning block of the impulse
+ *
+ * @return     true if a network is bound
+ */
+bool ei_aton_has_network(const ei_impulse_t *impulse, uint32_t learn_block_index = 0)
+{
+    for (size_t ix = 1; ix < aton_networks_count; ix++) {
+        if (aton_networks[ix].impulse == impulse && aton_networks[ix].learn_block_index == learn_block_index) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief      Get the NPU input buffer, so a capture can be written there directly
+ *             and the copy in run_nn_inference_image_quantized is skipped. Raw RGB888
+ *             pixels go there, they are converted in place for networks that take
+ *             normalised input
+ *
+ * @param[in]  impulse  The impulse, nullptr for the default network
+ * @param[out] len      Size of the input buffer in bytes
+ *
+ * @return     Pointer to the start of the NPU input buffer
+ */
+uint8_t *ei_aton_get_input_buffer(const ei_impulse_t *impulse, uint32_t *len)
+{
+    // the buffer is about to be written, the NPU must be done reading it
+    ei_aton_pipeline_wait();
+
+    ei_aton_network_t *net = ei_aton_get_network(impulse);
+
+    *len = LL_Buffer_len(&net->in_info[0]);
+
+    return net->nn_in;
+}
+
+/**
+ * @brief      Get the input buffer of the default network, see above
+ */
+uint8_t *ei_aton_get_input_buffer(uint32_t *len)
+{
+    return ei_aton_get_input_buffer(nullptr, len);
+}
+
+/**
+ * @brief      Register an epoch block callback on the network instance, used for profiling
+ *
+ * @param[in]  callback  Callback, or NULL to disable it. Must not be changed while
+ *                       an inference is running.
+ */
+void ei_aton_set_epoch_callback(TraceEpochBlock_FuncPtr_t callback)
+{
+    aton_epoch_callback = callback;
+
+    // networks that aren't initialised yet pick it up on first use
+    for (size_t ix = 0; ix < aton_networks_count; ix++) {
+        LL_ATON_RT_SetEpochCallback(callback, aton_networks[ix].instance);
+    }
+}
+
+/**
+ * Input conversion of a network: the quantised NPU input value of every source byte comes from
+ * the lookup tables of extract_image_features_quantized (ei_image_quant_lut_get), for the image
+ * scaling of the impulse and the scale / offset of the NPU input buffer. Networks taking raw
+ * pixels, or whose tables map every byte to itself, are staged with plain copies.
+ */
+typedef struct {
+    const LL_Buffer_InfoTypeDef *in_info;
+    int image_scaling;
+    bool identity;
+#if EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
+    const ei_image_quant_lut_t *quant;      // nullptr when identity
+#endif
+} ei_aton_input_lut_t;
+
+/**
+ * @brief      Get the input conversion of a network, checked again when another network
+ *             (or an impulse with another image scaling) is staged
+ *
+ * @param[in]  impulse  The impulse
+ * @param[in]  in_info  NPU input buffer
+ *
+ * @return     The input conversion
+ */
+static const ei_aton_input_lut_t *ei_aton_get_input_lut(const ei_impulse_t *impulse, const LL_Buffer_InfoTypeDef *in_info)
+{
+    static ei_aton_input_lut_t lut = { nullptr, 0, true };
+    const int image_scaling = impulse->learning_blocks[0].image_scaling;
+
+    if (lut.in_info == in_info && lut.image_scaling == image_scaling) {
+#if EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
+        if (!lut.identity) {
+            // the tables are shared with the DSP path, another model may have rebuilt them
+            lut.quant = ei_image_quant_lut_get(3, in_info->scale[0], in_info->offset[0], image_scaling,
+                in_info->type == DataType_UINT8);
+        }
+#endif
+        return &lut;
+    }
+
+    lut.in_info = in_info;
+    lut.image_scaling = image_scaling;
+    lut.identity = true;
+
+#if EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
+    lut.quant = nullptr;
+
+    if ((in_info->type == DataType_INT8 || in_info->type == DataType_UINT8) && in_info->scale && in_info->offset) {
+        // UINT8 inputs get tables holding the bytes of the uint8 values
+        const ei_image_quant_lut_t *quant = ei_image_quant_lut_get(3, in_info->scale[0], in_info->offset[0], image_scaling,
+            in_info->type == DataType_UINT8);
+
+        bool identity = quant->src_channel[0] == 0 && quant->src_channel[2] == 2;
+        for (int c = 0; c < 3 && identity; c++) {
+            for (int v = 0; v < 256 && identity; v++) {
+                identity = static_cast<uint8_t>(quant->rgb[c][v]) == v;
+            }
+        }
+
+        lut.identity = identity;
+        lut.quant = identity ? nullptr : quant;
+    }
+#endif
+
+    return &lut;
+}
+
+/**
+ * Convert a row of RGB888 pixels into NPU input, src and dst may be the same row
+ */
+static void ei_aton_convert_row(const uint8_t *src, uint8_t *dst, size_t pixels, const ei_aton_input_lut_t *lut)
+{
+    if (lut->identity) {
+        if (src != dst) {
+            memcpy(dst, src, pixels * 3);
+        }
+        return;
+    }
+
+#if EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
+    ei_quantize_row_rgb(src, 3, pixels, reinterpret_cast<int8_t *>(dst), lut->quant);
+#endif
+}
+
+/**
+ * @brief      Stage the RGB888 frame of the signal into the NPU input buffer. The frame
+ *             (usually in PSRAM) is read once, converted to the NPU input format on the
+ *             way and written in stripes of EI_ATON_STAGE_STRIPE_BYTES, each stripe is
+ *             cleaned from the D-cache while it is still cached, instead of copying the
+ *             whole frame and walking the whole buffer again afterwards. A frame written
+ *             straight into the NPU input buffer (packed rows) is converted in place
+ *
+ * @param[in]  impulse  The impulse
+ * @param[in]  signal   Image signal, read from its byte view when it has one
+ * @param[in]  in_info  NPU input buffer
+ * @param[out] dst      NPU input buffer
+ *
+ * @return     EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR ei_aton_stage_input(
     const ei_impulse_t *impulse,
     signal_t *signal,
-    ei_impulse_result_t *result,
-    void *config_ptr,
-    bool debug = false)
+    const LL_Buffer_InfoTypeDef *in_info,
+    uint8_t *dst)
 {
-    EI_IMPULSE_ERROR fill_res = EI_IMPULSE_OK;
-    extern uint8_t *global_camera_buffer;
-    extern uint8_t *snapshot_buf;
-    // this needs to be changed for multi-model, multi-impulse
-    static bool first_run = true;
+    const size_t row_bytes = impulse->input_width * 3;
+    const image_view_t *image = signal->image;
+    const ei_aton_input_lut_t *lut = ei_aton_get_input_lut(impulse, in_info);
 
-    uint64_t ctx_start_us = ei_read_timer_us();
+    if (image && image->data && image->format == EI_IMAGE_FORMAT_RGB888 &&
+        image->width == impulse->input_width && image->height == impulse->input_height) {
 
-    #if DATA_OUT_FORMAT_FLOAT32
-    static float32_t *nn_out;
-    #else
-    static uint8_t *nn_out;
-    #endif
-    static uint32_t nn_out_len;
+        // raw pixels already in place, the writer cleaned them from the D-cache
+        if (image->data == dst && lut->identity) {
+            return EI_IMPULSE_OK;
+        }
+
+        uint32_t stripe_rows = EI_ATON_STAGE_STRIPE_BYTES / row_bytes;
+        if (stripe_rows == 0) {
+            stripe_rows = 1;
+        }
+
+        for (uint32_t y = 0; y < impulse->input_height; y += stripe_rows) {
+            const uint32_t rows = impulse->input_height - y < stripe_rows ? impulse->input_height - y : stripe_rows;
+            uint8_t *stripe = dst + y * row_bytes;
+
+            if (lut->identity && image->stride == row_bytes) {
+                memcpy(stripe, image->data + y * row_bytes, rows * row_bytes);
+            }
+            else {
+                for (uint32_t row = 0; row < rows; row++) {
+                    ei_aton_convert_row(image->data + (y + row) * image->stride,
+                        stripe + row * row_bytes, impulse->input_width, lut);
+                }
+            }
+
+            #ifdef USE_DCACHE
+            SCB_CleanInvalidateDCache_by_Addr(stripe, rows * row_bytes);
+            #endif
+        }
+        return EI_IMPULSE_OK;
+    }
 
-    if(first_run == true) {
+    // no byte view, unpack the packed float pixels one page at a time
+    const size_t page_size = 256;
+    float page[page_size];
+    uint8_t rgb[page_size * 3];
+    const size_t pixels = impulse->input_width * impulse->input_height;
 
-        nn_in_info = LL_ATON_Input_Buffers_Info_Default();
-        nn_out_info = LL_ATON_Output_Buffers_Info_Default();
+    for (size_t offset = 0; offset < pixels; offset += page_size) {
+        size_t count = pixels - offset > page_size ? page_size : pixels - offset;
 
-        nn_in = (uint8_t *) LL_Buffer_addr_start(&nn_in_info[0]);
-        uint32_t nn_in_len = LL_Buffer_len(&nn_in_info[0]);
+        if (signal->get_data(offset, count, page) != 0) {
+            return EI_IMPULSE_DSP_ERROR;
+        }
 
+        for (size_t i = 0; i < count; i++) {
+            uint32_t pixel = static_cast<uint32_t>(page[i]);
+            rgb[i * 3] = pixel >> 16 & 0xff;
+            rgb[i * 3 + 1] = pixel >> 8 & 0xff;
+            rgb[i * 3 + 2] = pixel & 0xff;
+        }
 
-        #if DATA_OUT_FORMAT_FLOAT32
-        nn_out = (float32_t *) nn_out_info[0].addr_base.p;
-        #else
-        nn_out = (uint8_t *) LL_Buffer_addr_start(&nn_out_info[0]);
+        uint8_t *chunk = dst + offset * 3;
+        ei_aton_convert_row(rgb, chunk, count, lut);
+
+        #ifdef USE_DCACHE
+        SCB_CleanInvalidateDCache_by_Addr(chunk, count * 3);
         #endif
-        nn_out_len = LL_Buffer_len(&nn_out_info[0]);
-        
-        first_run = false;
     }
 
-    memcpy(nn_in, snapshot_buf, impulse->input_width * impulse->input_height * 3);
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Quantize the input features into the NPU input buffer of a network
+ *
+ * @param[in]  net                   The network
+ * @param[in]  fmatrix               Processed matrices
+ * @param[in]  input_block_ids       Blocks whose output is the network input
+ * @param[in]  input_block_ids_size
+ * @param[in]  mtx_size              Number of matrices
+ *
+ * @return     EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR ei_aton_fill_input(
+    ei_aton_network_t *net,
+    ei_feature_t *fmatrix,
+    uint32_t *input_block_ids,
+    uint32_t input_block_ids_size,
+    size_t mtx_size)
+{
+    const LL_Buffer_InfoTypeDef *in_info = &net->in_info[0];
+    const uint32_t nn_in_len = LL_Buffer_len(in_info);
+    size_t input_idx = 0;
+
+    for (size_t i = 0; i < input_block_ids_size; i++) {
+#if EI_CLASSIFIER_SINGLE_FEATURE_INPUT == 0
+        size_t cur_mtx = input_block_ids[i];
+        ei::matrix_t* matrix = NULL;
+
+        if (!find_mtx_by_idx(fmatrix, &matrix, cur_mtx, mtx_size)) {
+            ei_printf("ERR: Cannot find matrix with id %zu\n", cur_mtx);
+            return EI_IMPULSE_INVALID_SIZE;
+        }
+#else
+        ei::matrix_t* matrix = fmatrix[0].matrix;
+#endif
+        const size_t els = matrix->rows * matrix->cols;
+
+        switch (in_info->type) {
+            case DataType_FLOAT: {
+                if ((input_idx + els) * sizeof(float) > nn_in_len) {
+                    return EI_IMPULSE_INVALID_SIZE;
+                }
+                memcpy((float *)net->nn_in + input_idx, matrix->buffer, els * sizeof(float));
+                break;
+            }
+            case DataType_INT8: {
+                if (input_idx + els > nn_in_len) {
+                    return EI_IMPULSE_INVALID_SIZE;
+                }
+                int8_t *dst = (int8_t *)net->nn_in + input_idx;
+                for (size_t ix = 0; ix < els; ix++) {
+                    dst[ix] = static_cast<int8_t>(
+                        pre_cast_quantize(matrix->buffer[ix], in_info->scale[0], in_info->offset[0], true));
+                }
+                break;
+            }
+            case DataType_UINT8: {
+                if (input_idx + els > nn_in_len) {
+                    return EI_IMPULSE_INVALID_SIZE;
+                }
+                uint8_t *dst = net->nn_in + input_idx;
+                for (size_t ix = 0; ix < els; ix++) {
+                    dst[ix] = static_cast<uint8_t>(
+                        pre_cast_quantize(matrix->buffer[ix], in_info->scale[0], in_info->offset[0], false));
+                }
+                break;
+            }
+            default: {
+                ei_printf("ERR: Cannot handle NPU input type (%d)\n", in_info->type);
+                return EI_IMPULSE_INPUT_TENSOR_WAS_NULL;
+            }
+        }
+
+        input_idx += els;
+    }
+
     #ifdef USE_DCACHE
-    SCB_CleanInvalidateDCache_by_Addr(nn_in, impulse->input_width * impulse->input_height * 3);
+    SCB_CleanInvalidateDCache_by_Addr(net->nn_in, nn_in_len);
     #endif
 
-    LL_ATON_RT_Main(&NN_Instance_Default);
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Dequantize an NPU output buffer
+ *
+ * @param[in]  out_info  Output buffer
+ * @param[in]  nn_out    Data of the output buffer
+ * @param[out] dst       Output values
+ * @param[in]  count     Number of values expected in the buffer
+ *
+ * @return     EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR ei_aton_dequantize_output(const LL_Buffer_InfoTypeDef *out_info, const uint8_t *nn_out, float *dst, size_t count)
+{
+    const uint32_t nn_out_len = LL_Buffer_len(out_info);
+
+    switch (out_info->type) {
+        case DataType_FLOAT: {
+            if (nn_out_len / sizeof(float) != count) {
+                break;
+            }
+            memcpy(dst, nn_out, nn_out_len);
+            return EI_IMPULSE_OK;
+        }
+        case DataType_INT8: {
+            if (nn_out_len != count) {
+                break;
+            }
+            for (size_t ix = 0; ix < count; ix++) {
+                dst[ix] = static_cast<float>(((const int8_t *)nn_out)[ix] - out_info->offset[0]) * out_info->scale[0];
+            }
+            return EI_IMPULSE_OK;
+        }
+        case DataType_UINT8: {
+            if (nn_out_len != count) {
+                break;
+            }
+            for (size_t ix = 0; ix < count; ix++) {
+                dst[ix] = static_cast<float>(nn_out[ix] - out_info->offset[0]) * out_info->scale[0];
+            }
+            return EI_IMPULSE_OK;
+        }
+        default: {
+            ei_printf("ERR: Cannot handle NPU output type (%d)\n", out_info->type);
+            return EI_IMPULSE_OUTPUT_TENSOR_WAS_NULL;
+        }
+    }
+
+    ei_printf("ERR: NPU output has size %d, but expected %d values\n", (int)nn_out_len, (int)count);
+    return EI_IMPULSE_INVALID_SIZE;
+}
+
+/**
+ * @brief      Run a network and drop the cached lines of its outputs
+ *
+ * @param[in]  net   The network
+ */
+static void ei_aton_run_network(ei_aton_network_t *net)
+{
+    LL_ATON_RT_Session_Run(net->instance);
 
     /* Discard all nn_out regions to avoid Dcache evictions during nn inference */
     #ifdef USE_DCACHE
     int i = 0;
-    while (nn_out_info[i].name != NULL) {
-            SCB_InvalidateDCache_by_Addr((float32_t *) LL_Buffer_addr_start(&nn_out_info[i]), LL_Buffer_len(&nn_out_info[i]));
+    while (net->out_info[i].name != NULL) {
+            SCB_InvalidateDCache_by_Addr((float32_t *) LL_Buffer_addr_start(&net->out_info[i]), LL_Buffer_len(&net->out_info[i]));
             i++;
     }
     #endif
+}
+
+/**
+ * @brief      Fill the result structure from the first output buffer of a network
+ *
+ * @param[in]  impulse       The impulse
+ * @param[in]  block_config  Config of the learning block run by the network
+ * @param      result        Output classifier results
+ * @param[in]  nn_out_info   Output buffers of the network
+ * @param[in]  nn_out_data   Data of the first output, the NPU buffer or a copy of it
+ * @param[in]  debug         Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+static EI_IMPULSE_ERROR ei_aton_fill_result(
+    const ei_impulse_t *impulse,
+    ei_learning_block_config_tflite_graph_t *block_config,
+    ei_impulse_result_t *result,
+    const LL_Buffer_InfoTypeDef *nn_out_info,
+    const uint8_t *nn_out_data,
+    bool debug)
+{
+    EI_IMPULSE_ERROR fill_res = EI_IMPULSE_OK;
+
+    #if DATA_OUT_FORMAT_FLOAT32
+    float32_t *nn_out = (float32_t *) nn_out_data;
+    #else
+    uint8_t *nn_out = (uint8_t *) nn_out_data;
+    #endif
+    uint32_t nn_out_len = LL_Buffer_len(&nn_out_info[0]);
 
-    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t *)impulse->learning_blocks[0].config;
     if (block_config->classification_mode == EI_CLASSIFIER_CLASSIFICATION_MODE_OBJECT_DETECTION) {
         switch (block_config->object_detection_last_layer) {
 
@@ -204,20 +720,244 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
         }
 
     }
+    else if (block_config->classification_mode == EI_CLASSIFIER_CLASSIFICATION_MODE_VISUAL_ANOMALY)
+    {
+        if (!result->copy_output) {
+            if (nn_out_info[0].type == DataType_FLOAT) {
+                fill_res = fill_result_visual_ad_struct_f32(impulse, result, (float *)nn_out, block_config, debug);
+            }
+            else {
+                // the grid is small, dequantize it for the float post-processing
+                ei::matrix_t scores(1, nn_out_len);
+                if (scores.buffer == nullptr) {
+                    return EI_IMPULSE_ALLOC_FAILED;
+                }
+                fill_res = ei_aton_dequantize_output(&nn_out_info[0], (const uint8_t *)nn_out, scores.buffer, nn_out_len);
+                if (fill_res == EI_IMPULSE_OK) {
+                    fill_res = fill_result_visual_ad_struct_f32(impulse, result, scores.buffer, block_config, debug);
+                }
+            }
+        }
+    }
     // if we copy the output, we don't need to process it as classification
     else
     {
         if (!result->copy_output) {
-            bool int8_output = 1; //quantized hardcoded for now
-            if (int8_output) {
+            if (nn_out_info[0].type == DataType_FLOAT) {
+                fill_res = fill_result_struct_f32(impulse, result, (float *)nn_out, debug);
+            }
+            else if (nn_out_info[0].type == DataType_INT8) {
                 fill_res = fill_result_struct_i8(impulse, result, (int8_t *)nn_out, nn_out_info[0].offset[0], nn_out_info[0].scale[0], debug);
             }
             else {
-                fill_res = fill_result_struct_f32(impulse, result,(float *)nn_out, debug);
+                ei::matrix_t scores(1, nn_out_len);
+                if (scores.buffer == nullptr) {
+                    return EI_IMPULSE_ALLOC_FAILED;
+                }
+                fill_res = ei_aton_dequantize_output(&nn_out_info[0], (const uint8_t *)nn_out, scores.buffer, nn_out_len);
+                if (fill_res == EI_IMPULSE_OK) {
+                    fill_res = fill_result_struct_f32(impulse, result, scores.buffer, debug);
+                }
             }
         }
     }
 
+    return fill_res;
+}
+
+#if EI_ATON_PIPELINE_SUPPORTED
+/**
+ * @brief      NPU thread of pipelined inference, runs the network it is started on
+ */
+static void ei_aton_npu_thread_fct(ULONG arg)
+{
+    (void)arg;
+
+    while (1) {
+        tx_semaphore_get(&aton_npu_start, TX_WAIT_FOREVER);
+        ei_aton_run_network(aton_pipeline.busy);
+        tx_semaphore_put(&aton_npu_done);
+    }
+}
+#endif
+
+/**
+ * @brief      Wait for the network running on the NPU thread, if any, and copy its first
+ *             output out of NPU memory, so the NPU can be given the next frame
+ */
+static void ei_aton_pipeline_wait(void)
+{
+#if EI_ATON_PIPELINE_SUPPORTED
+    ei_aton_network_t *net = aton_pipeline.busy;
+
+    if (net == nullptr) {
+        return;
+    }
+
+    tx_semaphore_get(&aton_npu_done, TX_WAIT_FOREVER);
+    aton_pipeline.busy = nullptr;
+
+    memcpy(aton_pipeline.out_copy, LL_Buffer_addr_start(&net->out_info[0]), LL_Buffer_len(&net->out_info[0]));
+    aton_pipeline.pending = net;
+    aton_pipeline.pending_impulse = aton_pipeline.busy_impulse;
+#endif
+}
+
+/**
+ * @brief      Pipeline run_nn_inference_image_quantized: the frame is staged and the NPU
+ *             started on it, the previous frame is decoded while the NPU runs. Capture of
+ *             the next frame overlaps both, so a frame takes as long as the slowest stage
+ *             rather than the sum of them. Results lag one frame behind, the first frame
+ *             returns none (see ei_aton_pipeline_has_result). The NPU input buffer must not
+ *             be written between two calls, ei_aton_get_input_buffer waits for the NPU.
+ *
+ * @param[in]  enable  Enable or disable (waits for the NPU and drops the frame in flight)
+ *
+ * @return     false if pipelining isn't supported (not a ThreadX build) or the NPU thread
+ *             can't be started
+ */
+bool ei_aton_set_pipelined(bool enable)
+{
+#if EI_ATON_PIPELINE_SUPPORTED
+    if (!enable) {
+        ei_aton_pipeline_wait();
+        aton_pipeline.enabled = false;
+        aton_pipeline.has_result = false;
+        aton_pipeline.pending = nullptr;
+        ei_free(aton_pipeline.out_copy);
+        aton_pipeline.out_copy = nullptr;
+        aton_pipeline.out_copy_size = 0;
+        return true;
+    }
+
+    if (!aton_npu_thread_created) {
+        // above the caller, so NPU events are handled while it decodes
+        UINT priority = 0;
+        tx_thread_info_get(tx_thread_identify(), nullptr, nullptr, nullptr, &priority, nullptr, nullptr, nullptr, nullptr);
+        if (priority > 0) {
+            priority--;
+        }
+
+        tx_semaphore_create(&aton_npu_start, (CHAR *)"ei_aton_npu_start", 0);
+        tx_semaphore_create(&aton_npu_done, (CHAR *)"ei_aton_npu_done", 0);
+        if (tx_thread_create(&aton_npu_thread, (CHAR *)"ei_aton_npu", ei_aton_npu_thread_fct, 0,
+                aton_npu_thread_stack, sizeof(aton_npu_thread_stack), priority, priority,
+                TX_NO_TIME_SLICE, TX_AUTO_START) != TX_SUCCESS) {
+            EI_LOGE("Failed to start the NPU thread\n");
+            tx_semaphore_delete(&aton_npu_start);
+            tx_semaphore_delete(&aton_npu_done);
+            return false;
+        }
+        aton_npu_thread_created = true;
+    }
+
+    aton_pipeline.enabled = true;
+    aton_pipeline.has_result = false;
+
+    return true;
+#else
+    return !enable;
+#endif
+}
+
+/**
+ * @brief      Whether the last pipelined inference returned a result (of the previous frame)
+ */
+bool ei_aton_pipeline_has_result(void)
+{
+    return aton_pipeline.has_result;
+}
+
+/**
+ * @brief      Pipelined run_nn_inference_image_quantized, see ei_aton_set_pipelined
+ */
+static EI_IMPULSE_ERROR ei_aton_run_pipelined(
+    const ei_impulse_t *impulse,
+    ei_aton_network_t *net,
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    bool debug)
+{
+#if EI_ATON_PIPELINE_SUPPORTED
+    uint64_t ctx_start_us = ei_read_timer_us();
+
+    // the previous frame must be off the NPU before this one is staged
+    ei_aton_pipeline_wait();
+    aton_pipeline.has_result = false;
+
+    const size_t out_len = LL_Buffer_len(&net->out_info[0]);
+    if (aton_pipeline.out_copy_size < out_len) {
+        ei_free(aton_pipeline.out_copy);
+        aton_pipeline.pending = nullptr;
+        aton_pipeline.out_copy_size = 0;
+        aton_pipeline.out_copy = (uint8_t *)ei_malloc(out_len);
+        if (aton_pipeline.out_copy == nullptr) {
+            return EI_IMPULSE_ALLOC_FAILED;
+        }
+        aton_pipeline.out_copy_size = out_len;
+    }
+
+    EI_IMPULSE_ERROR copy_res = ei_aton_stage_input(impulse, signal, &net->in_info[0], net->nn_in);
+    if (copy_res != EI_IMPULSE_OK) {
+        return copy_res;
+    }
+
+    aton_pipeline.busy = net;
+    aton_pipeline.busy_impulse = impulse;
+    tx_semaphore_put(&aton_npu_start);
+
+    EI_IMPULSE_ERROR fill_res = EI_IMPULSE_OK;
+    if (aton_pipeline.pending) {
+        const ei_impulse_t *pending_impulse = aton_pipeline.pending_impulse;
+        ei_learning_block_config_tflite_graph_t *block_config =
+            (ei_learning_block_config_tflite_graph_t *)pending_impulse->learning_blocks[0].config;
+
+        fill_res = ei_aton_fill_result(pending_impulse, block_config, result,
+            aton_pipeline.pending->out_info, aton_pipeline.out_copy, debug);
+        aton_pipeline.pending = nullptr;
+        aton_pipeline.has_result = true;
+    }
+
+    // staging and decode, the NPU time is hidden behind them
+    result->timing.classification_us = ei_read_timer_us() - ctx_start_us;
+
+    return fill_res;
+#else
+    return EI_IMPULSE_UNSUPPORTED_INFERENCING_ENGINE;
+#endif
+}
+
+EI_IMPULSE_ERROR run_nn_inference_image_quantized(
+    const ei_impulse_t *impulse,
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    void *config_ptr,
+    bool debug = false)
+{
+    uint64_t ctx_start_us = ei_read_timer_us();
+
+    // the NPU may still be running the previous frame of a pipeline
+    ei_aton_pipeline_wait();
+
+    ei_aton_network_t *net = ei_aton_get_network(impulse);
+
+    if (aton_pipeline.enabled) {
+        return ei_aton_run_pipelined(impulse, net, signal, result, debug);
+    }
+
+    uint8_t *nn_in = net->nn_in;
+
+    EI_IMPULSE_ERROR copy_res = ei_aton_stage_input(impulse, signal, &net->in_info[0], nn_in);
+    if (copy_res != EI_IMPULSE_OK) {
+        return copy_res;
+    }
+
+    ei_aton_run_network(net);
+
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t *)impulse->learning_blocks[0].config;
+    EI_IMPULSE_ERROR fill_res = ei_aton_fill_result(impulse, block_config, result, net->out_info,
+        (const uint8_t *)LL_Buffer_addr_start(&net->out_info[0]), debug);
+
     result->timing.classification_us = ei_read_timer_us() - ctx_start_us;
 
     return fill_res;
@@ -243,9 +983,42 @@ EI_IMPULSE_ERROR run_nn_inference(
     void *config_ptr,
     bool debug = false)
 {
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
+
+    uint64_t ctx_start_us = ei_read_timer_us();
 
+    ei_aton_pipeline_wait();
 
-    return EI_IMPULSE_OK;
+    ei_aton_network_t *net = ei_aton_get_network(impulse, learn_block_index);
+    if (net == nullptr) {
+        return EI_IMPULSE_DEVICE_INIT_ERROR;
+    }
+
+    size_t mtx_size = impulse->dsp_blocks_size + impulse->learning_blocks_size;
+    EI_IMPULSE_ERROR input_res = ei_aton_fill_input(net, fmatrix, input_block_ids, input_block_ids_size, mtx_size);
+    if (input_res != EI_IMPULSE_OK) {
+        return input_res;
+    }
+
+    ei_aton_run_network(net);
+
+    // the next learning block takes this one's output, e.g. the visual anomaly GMM
+    if (result->copy_output) {
+        ei::matrix_t *output = fmatrix[impulse->dsp_blocks_size + learn_block_index].matrix;
+        EI_IMPULSE_ERROR output_res = ei_aton_dequantize_output(&net->out_info[0],
+            (const uint8_t *)LL_Buffer_addr_start(&net->out_info[0]), output->buffer, output->rows * output->cols);
+        if (output_res != EI_IMPULSE_OK) {
+            return output_res;
+        }
+    }
+
+    EI_IMPULSE_ERROR fill_res = ei_aton_fill_result(impulse, block_config, result, net->out_info,
+        (const uint8_t *)LL_Buffer_addr_start(&net->out_info[0]), debug);
+
+    result->timing.classification_us = ei_read_timer_us() - ctx_start_us;
+    result->timing.classification = (int)(result->timing.classification_us / 1000);
+
+    return fill_res;
 }
 
 #endif // EI_CLASSIFIER_INFERENCING_ENGINE
@@ -44,16 +44,27 @@ float centroid_euclidean_distance(const ei_impulse_result_bounding_box_t bbox1,
 
 class JonkerVolgenantAlignment {
 public:
-    JonkerVolgenantAlignment(float threshold, bool use_iou = true) : threshold(threshold), use_iou(use_iou) {
+    /**
+     * @param gated If set, only pairs that pass the threshold are considered and
+     *              LSAP is only run on clusters of pairs that compete with each
+     *              other, see align_gated(). Scales to crowded scenes, but can give
+     *              a different assignment than the dense solve.
+     */
+    JonkerVolgenantAlignment(float threshold, bool use_iou = true, bool gated = false)
+        : threshold(threshold), use_iou(use_iou), gated(gated) {
     }
 
-    std::vector<std::tuple<int, int, float>> align(const std::vector<ei_impulse_result_bounding_box_t> traces,
-                                                   const std::vector<ei_impulse_result_bounding_box_t> detections) {
+    std::vector<std::tuple<int, int, float>> align(const std::vector<ei_impulse_result_bounding_box_t> &traces,
+                                                   const std::vector<ei_impulse_result_bounding_box_t> &detections) {
 
         if (traces.empty() || detections.empty()) {
             return {};
         }
 
+        if (gated) {
+            return align_gated(traces, detections);
+        }
+
         std::vector<double> cost_mtx(traces.size() * detections.size());
         for (size_t trace_idx = 0; trace_idx < traces.size(); ++trace_idx) {
             for (size_t detection_idx = 0; detection_idx < detections.size(); ++detection_idx) {
@@ -108,8 +119,203 @@ public:
         return matches;
     }
 
+    /**
+     * Sparse alignment. Pairs that pass the threshold are grouped into connected
+     * components (traces and detections linked by such pairs). A component with
+     * a single trace or a single detection is matched on its lowest cost pair,
+     * the others are solved with LSAP on their own cost matrix, where pairs that
+     * don't pass the threshold are never picked.
+     */
+    std::vector<std::tuple<int, int, float>> align_gated(const std::vector<ei_impulse_result_bounding_box_t> &traces,
+                                                         const std::vector<ei_impulse_result_bounding_box_t> &detections) {
+        const size_t trace_count = traces.size();
+        const size_t detection_count = detections.size();
+
+        // detections sorted on x, so every trace only looks at the detections that can
+        // pass the threshold: overlapping in x for IoU, centroids closer than the
+        // threshold in x for distance
+        detection_order.resize(detection_count);
+        float max_detection_width = 0;
+        for (size_t i = 0; i < detection_count; i++) {
+            detection_order[i] = i;
+            max_detection_width = std::max(max_detection_width, (float)detections[i].width);
+        }
+        std::sort(detection_order.begin(), detection_order.end(), [&detections](int a, int b) {
+            return detections[a].x < detections[b].x;
+        });
+        const bool prune = use_iou ? (threshold >= 0) : true;
+
+        gated_pairs.clear();
+        for (size_t trace_idx = 0; trace_idx < trace_count; ++trace_idx) {
+            const ei_impulse_result_bounding_box_t &trace = traces[trace_idx];
+            float x_min, x_max;
+            if (use_iou) {
+                x_min = (float)trace.x - max_detection_width;
+                x_max = (float)trace.x + trace.width;
+            } else {
+                x_min = (float)trace.x + (trace.width / 2.0f) - threshold - (max_detection_width / 2.0f);
+                x_max = (float)trace.x + (trace.width / 2.0f) + threshold;
+            }
+
+            size_t order_idx = 0;
+            if (prune) {
+                order_idx = std::lower_bound(detection_order.begin(), detection_order.end(), x_min, [&detections](int a, float x) {
+                    return (float)detections[a].x < x;
+                }) - detection_order.begin();
+            }
+
+            for (; order_idx < detection_count; ++order_idx) {
+                size_t detection_idx = detection_order[order_idx];
+                if (prune && (float)detections[detection_idx].x > x_max) {
+                    break;
+                }
+                float cost;
+                bool pass;
+                if (use_iou) {
+                    float iou = intersection_over_union(traces[trace_idx], detections[detection_idx]);
+                    cost = 1 - iou;
+                    pass = iou > threshold;
+                } else {
+                    cost = centroid_euclidean_distance(traces[trace_idx], detections[detection_idx]);
+                    pass = cost < threshold;
+                }
+                if (pass) {
+                    gated_pairs.push_back({ (int)trace_idx, (int)detection_idx, 0, cost });
+                }
+            }
+        }
+
+        std::vector<std::tuple<int, int, float>> matches;
+        if (gated_pairs.empty()) {
+            return matches;
+        }
+
+        // connected components, nodes are traces followed by detections
+        component_parent.resize(trace_count + detection_count);
+        for (size_t i = 0; i < component_parent.size(); i++) {
+            component_parent[i] = i;
+        }
+        for (auto &pair : gated_pairs) {
+            int root_a = find_component(pair.trace_idx);
+            int root_b = find_component(trace_count + pair.detection_idx);
+            if (root_a != root_b) {
+                component_parent[root_b] = root_a;
+            }
+        }
+        for (auto &pair : gated_pairs) {
+            pair.component = find_component(pair.trace_idx);
+        }
+        std::sort(gated_pairs.begin(), gated_pairs.end(), [](const gated_pair_t &a, const gated_pair_t &b) {
+            if (a.component != b.component) return a.component < b.component;
+            if (a.cost != b.cost) return a.cost < b.cost;
+            if (a.trace_idx != b.trace_idx) return a.trace_idx < b.trace_idx;
+            return a.detection_idx < b.detection_idx;
+        });
+
+        trace_local_idx.assign(trace_count, -1);
+        detection_local_idx.assign(detection_count, -1);
+
+        size_t begin = 0;
+        while (begin < gated_pairs.size()) {
+            size_t end = begin;
+            size_t component_traces = 0;
+            size_t component_detections = 0;
+            while (end < gated_pairs.size() && gated_pairs[end].component == gated_pairs[begin].component) {
+                if (trace_local_idx[gated_pairs[end].trace_idx] < 0) {
+                    trace_local_idx[gated_pairs[end].trace_idx] = component_traces++;
+                }
+                if (detection_local_idx[gated_pairs[end].detection_idx] < 0) {
+                    detection_local_idx[gated_pairs[end].detection_idx] = component_detections++;
+                }
+                end++;
+            }
+
+            if (component_traces == 1 || component_detections == 1) {
+                // no competition, the lowest cost pair (sorted first) wins
+                const gated_pair_t &pair = gated_pairs[begin];
+                matches.emplace_back(pair.trace_idx, pair.detection_idx, use_iou ? 1 - pair.cost : pair.cost);
+            }
+            else {
+                EI_LOGD("gated alignment: solving %zu x %zu cluster\n", component_traces, component_detections);
+                solve_component(begin, end, component_traces, component_detections, matches);
+            }
+
+            for (size_t i = begin; i < end; i++) {
+                trace_local_idx[gated_pairs[i].trace_idx] = -1;
+                detection_local_idx[gated_pairs[i].detection_idx] = -1;
+            }
+            begin = end;
+        }
+
+        std::sort(matches.begin(), matches.end());
+        return matches;
+    }
+
     float threshold;
     bool use_iou;
+    bool gated;
+
+private:
+    typedef struct {
+        int trace_idx;
+        int detection_idx;
+        int component;
+        float cost;
+    } gated_pair_t;
+
+    int find_component(int node) {
+        while (component_parent[node] != node) {
+            component_parent[node] = component_parent[component_parent[node]];
+            node = component_parent[node];
+        }
+        return node;
+    }
+
+    void solve_component(size_t begin, size_t end, size_t rows, size_t cols,
+                         std::vector<std::tuple<int, int, float>> &matches) {
+        // cost of pairs that didn't pass the threshold, never picked over a gated pair
+        const double gated_out_cost = 1e9;
+
+        component_cost.assign(rows * cols, gated_out_cost);
+        component_trace_idx.resize(rows);
+        component_detection_idx.resize(cols);
+        for (size_t i = begin; i < end; i++) {
+            const gated_pair_t &pair = gated_pairs[i];
+            int row = trace_local_idx[pair.trace_idx];
+            int col = detection_local_idx[pair.detection_idx];
+            component_cost[row * cols + col] = pair.cost;
+            component_trace_idx[row] = pair.trace_idx;
+            component_detection_idx[col] = pair.detection_idx;
+        }
+
+        size_t num_iterations = rows > cols ? cols : rows;
+        component_a.resize(num_iterations);
+        component_b.resize(num_iterations);
+        if (solve(rows, cols, component_cost.data(), false, component_a.data(), component_b.data()) != 0) {
+            return;
+        }
+
+        for (size_t i = 0; i < num_iterations; i++) {
+            double cost = component_cost[component_a[i] * cols + component_b[i]];
+            if (cost == gated_out_cost) {
+                continue;
+            }
+            matches.emplace_back(component_trace_idx[component_a[i]], component_detection_idx[component_b[i]],
+                                 use_iou ? 1 - (float)cost : (float)cost);
+        }
+    }
+
+    // scratch space for align_gated(), kept between calls
+    std::vector<int> detection_order;
+    std::vector<gated_pair_t> gated_pairs;
+    std::vector<int> component_parent;
+    std::vector<int> trace_local_idx;
+    std::vector<int> detection_local_idx;
+    std::vector<int> component_trace_idx;
+    std::vector<int> component_detection_idx;
+    std::vector<double> component_cost;
+    std::vector<int64_t> component_a;
+    std::vector<int64_t> component_b;
 };
 
 class GreedyAlignment {
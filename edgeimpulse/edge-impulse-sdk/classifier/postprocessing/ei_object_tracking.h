@@ -54,13 +54,40 @@ float clip(float num, float min_val = -3.4028235e+38, float max_val = 3.4028235e
 
 #if EI_CLASSIFIER_OBJECT_TRACKING_ENABLED == 1
 
+// Traces are kept in a fixed pool inside the tracker, so this bounds the number
+// of objects tracked at the same time. Detections that would open a trace while
+// the pool is full are not tracked until a trace is closed.
+#ifndef EI_OBJECT_TRACKING_MAX_TRACES
+#define EI_OBJECT_TRACKING_MAX_TRACES 32
+#endif
+
+// Capacity of the per trace observation ring buffer, max_observations is clipped to this
+#ifndef EI_OBJECT_TRACKING_MAX_OBSERVATIONS
+#define EI_OBJECT_TRACKING_MAX_OBSERVATIONS 16
+#endif
+
+// Match traces to detections with the gated (sparse) alignment, which only
+// considers pairs passing the threshold. Faster with many objects in view.
+#ifndef EI_OBJECT_TRACKING_GATED_ALIGNMENT
+#define EI_OBJECT_TRACKING_GATED_ALIGNMENT 0
+#endif
+
 typedef struct {
     float keep_grace;
 } ei_obj_tracking_params_t;
 
 class ExponentialMovingAverage {
 public:
-    ExponentialMovingAverage(int n, float gain = 2) : gain(gain / (n + 1)), ema_value(-255.0) {
+    ExponentialMovingAverage() : gain(0), ema_value(-255.0) {
+    }
+
+    ExponentialMovingAverage(int n, float gain = 2) {
+        init(n, gain);
+    }
+
+    void init(int n, float gain = 2) {
+        this->gain = gain / (n + 1);
+        ema_value = -255.0;
     }
 
     void update(float value) {
@@ -71,7 +98,7 @@ public:
         }
     }
 
-    float smoothed_value() {
+    float smoothed_value() const {
         return ema_value;
     }
 
@@ -82,56 +109,68 @@ private:
 
 class Trace {
 public:
-    Trace(int id, int t, const ei_impulse_result_bounding_box_t& initial_bbox, uint32_t max_observations = 5)
-        : id(id), last_ground_truth_update_t(t), last_prediction(initial_bbox), max_observations(max_observations) {
+    Trace() : id(0), last_ground_truth_update_t(0), observation_head(0), observation_count(0), max_observations(0) {
+    }
+
+    Trace(int id, int t, const ei_impulse_result_bounding_box_t& initial_bbox, uint32_t max_observations = 5) {
+        init(id, t, initial_bbox, max_observations);
+    }
+
+    /**
+     * (Re)start the trace. All state is stored inline, so pooled traces can
+     * be reused without going through the heap.
+     */
+    void init(int id, int t, const ei_impulse_result_bounding_box_t& initial_bbox, uint32_t max_observations = 5) {
         if (max_observations < 2) {
             EI_LOGE("%s", "max_observations needs to be at least 2 for counting");
         }
+        if (max_observations > EI_OBJECT_TRACKING_MAX_OBSERVATIONS) {
+            EI_LOGW("max_observations clipped to %d (EI_OBJECT_TRACKING_MAX_OBSERVATIONS)\n", EI_OBJECT_TRACKING_MAX_OBSERVATIONS);
+            max_observations = EI_OBJECT_TRACKING_MAX_OBSERVATIONS;
+        }
+
+        this->id = id;
+        this->last_ground_truth_update_t = t;
+        this->last_prediction = initial_bbox;
+        this->max_observations = max_observations;
 
         trace_label = initial_bbox.label;
         trace_score = initial_bbox.value;
-        observations.push_back(initial_bbox);
+        observation_head = 0;
+        observation_count = 0;
+        push_observation(initial_bbox);
         float initial_centroid[2] = { initial_bbox.x + static_cast<float>(initial_bbox.width) / 2,
                                       initial_bbox.y + static_cast<float>(initial_bbox.height) / 2 };
 
         float initial_width_height[2] = { static_cast<float>(initial_bbox.width),
                                           static_cast<float>(initial_bbox.height) };
 
-        centroid_filter = new TinyEKF(initial_centroid, 8, 2);
-        width_height_filter = new TinyEKF(initial_width_height, 8, 2);
+        centroid_filter.init(initial_centroid, 8, 2);
+        width_height_filter.init(initial_width_height, 8, 2);
 
         // Use x0, y0, x1, y1 for EMAs
-        xyxy_emas[0] = new ExponentialMovingAverage(this->max_observations);
-        xyxy_emas[1] = new ExponentialMovingAverage(this->max_observations);
-        xyxy_emas[2] = new ExponentialMovingAverage(this->max_observations);
-        xyxy_emas[3] = new ExponentialMovingAverage(this->max_observations);
-    }
-
-    ~Trace() {
-        delete centroid_filter;
-        delete width_height_filter;
-        delete xyxy_emas[0];
-        delete xyxy_emas[1];
-        delete xyxy_emas[2];
-        delete xyxy_emas[3];
+        xyxy_emas[0].init(this->max_observations);
+        xyxy_emas[1].init(this->max_observations);
+        xyxy_emas[2].init(this->max_observations);
+        xyxy_emas[3].init(this->max_observations);
     }
 
     ei_impulse_result_bounding_box_t predict() {
-        fx_centroid[0] = centroid_filter->x[0];
-        fx_centroid[1] = centroid_filter->x[1];
-        fx_width_height[0] = width_height_filter->x[0];
-        fx_width_height[1] = width_height_filter->x[1];
+        fx_centroid[0] = centroid_filter.x[0];
+        fx_centroid[1] = centroid_filter.x[1];
+        fx_width_height[0] = width_height_filter.x[0];
+        fx_width_height[1] = width_height_filter.x[1];
 
-        centroid_filter->predict(fx_centroid);
-        width_height_filter->predict(fx_width_height);
+        centroid_filter.predict(fx_centroid);
+        width_height_filter.predict(fx_width_height);
 
         ei_impulse_result_bounding_box_t p_bbox = {"", 0, 0, 0, 0, 0.0};
         p_bbox.label = trace_label;
         p_bbox.value = trace_score;
-        p_bbox.x = round(clip((centroid_filter->x[0] - width_height_filter->x[0] / 2), 0));
-        p_bbox.y = round(clip(centroid_filter->x[1] - width_height_filter->x[1] / 2, 0));
-        p_bbox.width = round(clip(width_height_filter->x[0], 0));
-        p_bbox.height = round(clip(width_height_filter->x[1], 0));
+        p_bbox.x = round(clip((centroid_filter.x[0] - width_height_filter.x[0] / 2), 0));
+        p_bbox.y = round(clip(centroid_filter.x[1] - width_height_filter.x[1] / 2, 0));
+        p_bbox.width = round(clip(width_height_filter.x[0], 0));
+        p_bbox.height = round(clip(width_height_filter.x[1], 0));
         last_prediction = p_bbox;
         EI_LOGD("predict %d %d %d %d %f\n", last_prediction.x, last_prediction.y, last_prediction.width, last_prediction.height, last_prediction.value);
         return last_prediction;
@@ -146,38 +185,35 @@ public:
             last_ground_truth_update_t = t;
         }
 
-        hx_centroid[0] = centroid_filter->x[0];
-        hx_centroid[1] = centroid_filter->x[1];
-        hx_width_height[0] = width_height_filter->x[0];
-        hx_width_height[1] = width_height_filter->x[1];
+        hx_centroid[0] = centroid_filter.x[0];
+        hx_centroid[1] = centroid_filter.x[1];
+        hx_width_height[0] = width_height_filter.x[0];
+        hx_width_height[1] = width_height_filter.x[1];
 
         float centroid[2] = { bbox->x + static_cast<float>(bbox->width) / 2,
                               bbox->y + static_cast<float>(bbox->height) / 2 };
-        centroid_filter->update(centroid , hx_centroid);
+        centroid_filter.update(centroid , hx_centroid);
 
         float width_height[2] = { static_cast<float>(bbox->width),
                                   static_cast<float>(bbox->height) };
-        width_height_filter->update(width_height, hx_width_height);
+        width_height_filter.update(width_height, hx_width_height);
 
         trace_score = bbox->value;
-        observations.push_back(*bbox);
-        while (observations.size() > max_observations) {
-            observations.erase(observations.begin());
-        }
+        push_observation(*bbox);
 
-        xyxy_emas[0]->update(bbox->x);
-        xyxy_emas[1]->update(bbox->y);
-        xyxy_emas[2]->update(bbox->width);
-        xyxy_emas[3]->update(bbox->height);
+        xyxy_emas[0].update(bbox->x);
+        xyxy_emas[1].update(bbox->y);
+        xyxy_emas[2].update(bbox->width);
+        xyxy_emas[3].update(bbox->height);
 
     }
 
     std::tuple<int, int, int, int> last_centroid_segment() const {
-        if (observations.size() < 2) {
+        if (observation_count < 2) {
             return {};
         }
-        auto obs_t_minus1 = observations[observations.size() - 2];
-        auto obs_t_0 = observations.back();
+        auto obs_t_minus1 = observation(observation_count - 2);
+        auto obs_t_0 = observation(observation_count - 1);
 
         return {obs_t_minus1.x + static_cast<float>(obs_t_minus1.width) / 2,
                 obs_t_minus1.y + static_cast<float>(obs_t_minus1.height) / 2,
@@ -186,22 +222,22 @@ public:
     }
 
     const ei_impulse_result_bounding_box_t* last_observation() const {
-        if (observations.empty()) {
+        if (observation_count == 0) {
             return nullptr;
         }
-        return &observations.back();
+        return &observation(observation_count - 1);
     }
 
     ei_impulse_result_bounding_box_t smoothed_last_observation() const {
         ei_impulse_result_bounding_box_t bbox = {"", 0, 0, 0, 0, 0.0};
-        if (observations.empty()) {
+        if (observation_count == 0) {
             return bbox;
         }
 
-        bbox.x = round(xyxy_emas[0]->smoothed_value());
-        bbox.y = round(xyxy_emas[1]->smoothed_value());
-        bbox.width = round(xyxy_emas[2]->smoothed_value());
-        bbox.height = round(xyxy_emas[3]->smoothed_value());
+        bbox.x = round(xyxy_emas[0].smoothed_value());
+        bbox.y = round(xyxy_emas[1].smoothed_value());
+        bbox.width = round(xyxy_emas[2].smoothed_value());
+        bbox.height = round(xyxy_emas[3].smoothed_value());
         bbox.label = trace_label;
         bbox.value = trace_score;
         return bbox;
@@ -214,7 +250,8 @@ public:
         ei_printf("  Last ground truth update: %d\n", last_ground_truth_update_t);
         ei_printf("  Last prediction: %d %d %d %d %f\n", last_prediction.x, last_prediction.y, last_prediction.width, last_prediction.height, last_prediction.value);
         ei_printf("  Observations:\n");
-        for (const auto& obs : observations) {
+        for (uint32_t i = 0; i < observation_count; i++) {
+            const auto& obs = observation(i);
             ei_printf("%d %d %d %d %f\n", obs.x, obs.y, obs.width, obs.height, obs.value);
         }
 #endif
@@ -225,9 +262,27 @@ public:
     ei_impulse_result_bounding_box_t last_prediction;
 
 private:
-    std::vector<ei_impulse_result_bounding_box_t> observations;
-    TinyEKF* centroid_filter;
-    TinyEKF* width_height_filter;
+    // oldest observation first
+    const ei_impulse_result_bounding_box_t& observation(uint32_t ix) const {
+        return observations[(observation_head + ix) % EI_OBJECT_TRACKING_MAX_OBSERVATIONS];
+    }
+
+    void push_observation(const ei_impulse_result_bounding_box_t& bbox) {
+        observations[(observation_head + observation_count) % EI_OBJECT_TRACKING_MAX_OBSERVATIONS] = bbox;
+        if (observation_count < max_observations) {
+            observation_count++;
+        }
+        else {
+            // full, drop the oldest one
+            observation_head = (observation_head + 1) % EI_OBJECT_TRACKING_MAX_OBSERVATIONS;
+        }
+    }
+
+    ei_impulse_result_bounding_box_t observations[EI_OBJECT_TRACKING_MAX_OBSERVATIONS];
+    uint32_t observation_head;
+    uint32_t observation_count;
+    TinyEKF centroid_filter;
+    TinyEKF width_height_filter;
     uint32_t max_observations;
     float fx_centroid[2];
     float fx_width_height[2];
@@ -235,7 +290,7 @@ private:
     float hx_width_height[2];
     const char* trace_label;
     float trace_score;
-    ExponentialMovingAverage *xyxy_emas[4];
+    ExponentialMovingAverage xyxy_emas[4];
 };
 
 class Tracker {
@@ -243,29 +298,31 @@ public:
     Tracker (uint32_t keep_grace = 5, uint16_t max_observations = 5, float threshold = 0.5, bool use_iou = true)
             : keep_grace(keep_grace),
               max_observations(max_observations),
-              alignment(threshold, use_iou) {
+              alignment(threshold, use_iou, EI_OBJECT_TRACKING_GATED_ALIGNMENT == 1) {
         trace_seq_id = 0;
         t = 0;
-    }
 
-    ~Tracker() {
-        for (auto trace : open_traces) {
-            delete trace;
-        }
-        for (auto trace : closed_traces) {
-            delete trace;
+        // all storage is sized up front, so tracking does not go through the heap per frame
+        free_trace_count = 0;
+        for (int i = EI_OBJECT_TRACKING_MAX_TRACES - 1; i >= 0; i--) {
+            free_traces[free_trace_count++] = &trace_pool[i];
         }
+        open_traces.reserve(EI_OBJECT_TRACKING_MAX_TRACES);
+        traces_tmp.reserve(EI_OBJECT_TRACKING_MAX_TRACES);
+        last_obs_bboxes.reserve(EI_OBJECT_TRACKING_MAX_TRACES);
+        predicted_bboxes.reserve(EI_OBJECT_TRACKING_MAX_TRACES);
+        object_tracking_output.reserve(EI_OBJECT_TRACKING_MAX_TRACES);
     }
 
     std::vector<Trace*>open_traces;
-    std::vector<Trace*>closed_traces;
     std::vector<ei_object_tracking_trace_t> object_tracking_output;
+    std::vector<ei_impulse_result_bounding_box_t> detections;
 
     /**
      * Process new detections.
      * @param detections Bounding boxes, this vector might be reordered.
      */
-    void process_new_detections(std::vector<ei_impulse_result_bounding_box_t> detections) {
+    void process_new_detections(std::vector<ei_impulse_result_bounding_box_t> &detections) {
         // sort detections by x, y, width, height, label (same in Python code, see ei_tracking/tracking.py)
         // so it doesn't matter in what order we pass in the detections
         std::sort(detections.begin(), detections.end(), [](const ei_impulse_result_bounding_box_t& a, const ei_impulse_result_bounding_box_t& b) {
@@ -277,7 +334,7 @@ public:
         });
 
         // firstly try an alignment with last observations...
-        std::vector<ei_impulse_result_bounding_box_t> last_obs_bboxes;
+        last_obs_bboxes.clear();
         for (auto trace : open_traces) {
             last_obs_bboxes.push_back(*trace->last_observation());
         }
@@ -292,7 +349,7 @@ public:
         EI_LOGD("last_obs_cost %f\n", last_obs_cost);
 
         // ... then with the kalman filter predictions
-        std::vector<ei_impulse_result_bounding_box_t> predicted_bboxes;
+        predicted_bboxes.clear();
         for (auto trace : open_traces) {
             predicted_bboxes.push_back(trace->predict());
             EI_LOGD("predicted %d %d %d %d %f\n", trace->last_prediction.x, trace->last_prediction.y, trace->last_prediction.width, trace->last_prediction.height, trace->last_prediction.value);
@@ -307,29 +364,19 @@ public:
         EI_LOGD("predicted_cost %f\n", predicted_cost);
 
         // and use whichever matching set is better
-        std::vector<std::tuple<int, int, float>> matches;
+        const std::vector<std::tuple<int, int, float>> &matches =
+            (last_obs_cost < predicted_cost) ? last_obs_matches : predicted_matches;
 
         if (last_obs_cost < predicted_cost) {
             EI_LOGD("using last_obs_matches matches\n");
-            matches = last_obs_matches;
         }
         else {
             EI_LOGD("using predicted_matches matches\n");
-            matches = predicted_matches;
         }
 
         // assume all detections are unassigned and will becomes new tracks
-        // until we see otherwise ( i.e. they match an existing track )∂        //
-        std::set<uint16_t>unassigned_detection_idxs;
-        for (size_t i = 0; i < detections.size(); i++) {
-            unassigned_detection_idxs.insert(i);
-        }
-
-        // keep track of open traces idxs that haven't been updated
-        std::set<uint16_t>open_traces_idxs_to_be_updated;
-        for (size_t i = 0; i < open_traces.size(); i++) {
-            open_traces_idxs_to_be_updated.insert(i);
-        }
+        // until we see otherwise ( i.e. they match an existing track )
+        detection_assigned.assign(detections.size(), 0);
 
         // update existing traces with any matches
         for (size_t i = 0; i < matches.size(); i++) {
@@ -338,18 +385,26 @@ public:
             EI_LOGD("t_idx=%u d_idx=%u iou=%.6f\n", trace_idx, detection_idx, std::get<2>(matches[i]));
 
             Trace *trace = open_traces[trace_idx];
-            open_traces_idxs_to_be_updated.erase(trace_idx);
             trace->update(t, &detections[detection_idx]);
-            unassigned_detection_idxs.erase(detection_idx);
+            detection_assigned[detection_idx] = 1;
         }
 
-        for (auto detection_idx : unassigned_detection_idxs ) {
+        for (size_t detection_idx = 0; detection_idx < detections.size(); detection_idx++) {
+            if (detection_assigned[detection_idx]) {
+                continue;
+            }
+            if (free_trace_count == 0) {
+                EI_LOGW("no free trace for detection %d (EI_OBJECT_TRACKING_MAX_TRACES=%d)\n", (int)detection_idx, EI_OBJECT_TRACKING_MAX_TRACES);
+                continue;
+            }
             EI_LOGD("unassigned detection %d %d %d %d %d %f => starting new trace\n", detection_idx, detections[detection_idx].x, detections[detection_idx].y, detections[detection_idx].width, detections[detection_idx].height, detections[detection_idx].value);
-            open_traces.push_back(new Trace(trace_seq_id, t, detections[detection_idx], max_observations));
+            Trace *trace = free_traces[--free_trace_count];
+            trace->init(trace_seq_id, t, detections[detection_idx], max_observations);
+            open_traces.push_back(trace);
             trace_seq_id += 1;
         }
 
-        std::vector<Trace*>traces_tmp;
+        traces_tmp.clear();
 
         for (auto trace : open_traces) {
             EI_LOGD("grace checking trace %d at t=%d (trace.last_ground_truth_update_t=%d)\n", trace->id, t, trace->last_ground_truth_update_t);
@@ -357,7 +412,7 @@ public:
             if (time_since_last_update > keep_grace) {
                 // been too long since last update, close it
                 EI_LOGD("closing trace %d\n", trace->id);
-                closed_traces.push_back(trace);
+                free_traces[free_trace_count++] = trace;
             }
             else {
                 if (trace->last_ground_truth_update_t != t) {
@@ -370,7 +425,7 @@ public:
             }
         }
 
-        open_traces = traces_tmp;
+        open_traces.swap(traces_tmp);
         object_tracking_output.clear();
 
         for (auto trace : open_traces) {
@@ -404,6 +459,16 @@ private:
     uint32_t t;
     JonkerVolgenantAlignment alignment;
     std::vector<std::string> seen_labels;
+
+    Trace trace_pool[EI_OBJECT_TRACKING_MAX_TRACES];
+    Trace *free_traces[EI_OBJECT_TRACKING_MAX_TRACES];
+    uint32_t free_trace_count;
+
+    // per frame scratch space, kept between calls
+    std::vector<Trace*> traces_tmp;
+    std::vector<ei_impulse_result_bounding_box_t> last_obs_bboxes;
+    std::vector<ei_impulse_result_bounding_box_t> predicted_bboxes;
+    std::vector<uint8_t> detection_assigned;
 };
 
 EI_IMPULSE_ERROR init_object_tracking(ei_impulse_handle_t *handle, void** state, void *config)
@@ -449,9 +514,9 @@ EI_IMPULSE_ERROR process_object_tracking(ei_impulse_handle_t *handle,
         if((void *)object_tracker != NULL) {
             ei_impulse_result_bounding_box_t *bbs = result->bounding_boxes;
             uint32_t bbs_num = result->bounding_boxes_count;
-            std::vector<ei_impulse_result_bounding_box_t> detections(bbs, bbs + bbs_num);
+            object_tracker->detections.assign(bbs, bbs + bbs_num);
 
-            object_tracker->process_new_detections(detections);
+            object_tracker->process_new_detections(object_tracker->detections);
 
             result->postprocessed_output.object_tracking_output.open_traces = object_tracker->object_tracking_output.data();
             result->postprocessed_output.object_tracking_output.open_traces_count = object_tracker->object_tracking_output.size();
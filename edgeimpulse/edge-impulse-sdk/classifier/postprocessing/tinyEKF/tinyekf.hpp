@@ -28,21 +28,39 @@ void print_arr(T *arr, int m, int n, const char *name = "arr") {
 #endif
 }
 
+// state size supported by the inline storage below
+#define TINYEKF_MAX_N 8
+
 class TinyEKF {
 public:
+    TinyEKF() : EKF_N(0), EKF_M(0), dt(0) {
+    }
+
     TinyEKF(const float* x0, uint32_t EKF_N, uint32_t EKF_M,
             float dt = 0.1,
             float *u = nullptr,
             float process_noise_scale = 0.1,
             float observation_noise_scale=0.1)
-{
+    {
+        init(x0, EKF_N, EKF_M, dt, u, process_noise_scale, observation_noise_scale);
+    }
+
+    /**
+     * (Re)initialize the filter. All state is stored inline, so a filter
+     * can be reused without going through the heap.
+     */
+    void init(const float* x0, uint32_t EKF_N, uint32_t EKF_M,
+              float dt = 0.1,
+              const float *u = nullptr,
+              float process_noise_scale = 0.1,
+              float observation_noise_scale=0.1)
+    {
         // set private variables
-        this->EKF_N = EKF_N;
+        this->EKF_N = EKF_N > TINYEKF_MAX_N ? TINYEKF_MAX_N : EKF_N;
         this->EKF_M = EKF_M;
         this->dt = dt;
 
-        x = new float[this->EKF_N];
-        memset(x, 0, sizeof(float) * this->EKF_N);
+        memset(x, 0, sizeof(x));
         // x is the state
         x[0] = x0[0];
         x[1] = x0[1];
@@ -60,8 +78,7 @@ public:
         //      [0, 0, 0, 1]]
         // )
 
-        F = new float[16];
-        memset(F, 0, sizeof(float) * 16);
+        memset(F, 0, sizeof(F));
         for (int i = 0; i < 4; ++i) {
             for (int j = 0; j < 4; ++j) {
                 F[i * 4 + j] = (i == j) ? 1 : 0;
@@ -73,8 +90,7 @@ public:
         print_arr(F, 4, 4, "init F");
 
         // H is the observation model
-        H = new float[8];
-        memset(H, 0, sizeof(float) * 8);
+        memset(H, 0, sizeof(H));
 
         H[0] = H[5] = 1;
 
@@ -82,8 +98,7 @@ public:
         print_arr(H, 2, 4, "init H");
 
         // Q is the covariance of the process noise
-        Q = new float[16];
-        memset(Q, 0, sizeof(float) * 16);
+        memset(Q, 0, sizeof(Q));
 
         // self.Q = (
         //     np.array(
@@ -111,8 +126,7 @@ public:
         print_arr(Q, 4, 4, "init Q");
 
         // R is the covariance of the observation noise
-        R = new float[4];
-        memset(R, 0, sizeof(float) * 4);
+        memset(R, 0, sizeof(R));
 
         for (int i = 0; i < 2; ++i) {
             for (int j = 0; j < 2; ++j) {
@@ -130,20 +144,20 @@ public:
         //      [0, self.dt]]
         // )
 
-        B = new float[this->EKF_N * this->EKF_N * 2];
-        memset(B, 0, sizeof(float) * this->EKF_N * this->EKF_N * 2);
+        memset(B, 0, sizeof(B));
         B[0] = B[3] = (dt * dt) / 2;
         B[4] = B[7] = dt;
 
         if (u == nullptr) {
-            u = new float[2];
-            u[0] = u[1] = 0.1;
+            this->u[0] = this->u[1] = 0.1;
+        }
+        else {
+            this->u[0] = u[0];
+            this->u[1] = u[1];
         }
-        this->u = u;
 
         // P is the predict / update transition
-        P = new float[16];
-        memset(P, 0, sizeof(float) * 16);
+        memset(P, 0, sizeof(P));
 
         for (int i = 0; i < 4; ++i) {
             for (int j = 0; j < 4; ++j) {
@@ -155,32 +169,22 @@ public:
         print_arr(P, 4, 4, "init P");
     }
 
-    ~TinyEKF() {
-        delete[] x;
-        delete[] P;
-        delete[] Q;
-        delete[] F;
-        delete[] H;
-        delete[] R;
-        delete[] B;
-        delete[] u;
-    }
-
     void predict(const float *fx);
     bool update(const float *z, const float *hx);
-    float *x;
+    float x[TINYEKF_MAX_N];
 private:
     uint32_t EKF_N;
     uint32_t EKF_M;
 
-    float *P;
-    float *Q;
-    float *F;
-    float *H;
-    float *R;
+    float P[16];
+    float Q[16];
+    float F[16];
+    float H[8];
+    float R[4];
 
-    float *B;
-    float *u;
+    // B is 4x2, u is 2x1
+    float B[8];
+    float u[2];
     float dt;
 
     void update_step3(float *GH);
@@ -417,6 +417,71 @@ int crop_and_interpolate_image(
     return resize_image(dstImage, cropWidth, cropHeight, dstImage, dstWidth, dstHeight, pixel_size_B);
 }
 
+int crop_and_resize_image(
+    const uint8_t *srcImage,
+    int srcWidth,
+    int srcHeight,
+    int startX,
+    int startY,
+    int cropWidth,
+    int cropHeight,
+    uint8_t *dstImage,
+    int dstWidth,
+    int dstHeight,
+    int pixel_size_B)
+{
+    constexpr int FRAC_BITS = 14;
+    constexpr int FRAC_VAL = (1 << FRAC_BITS);
+    constexpr int FRAC_MASK = (FRAC_VAL - 1);
+
+    if (startX < 0 || startY < 0 || cropWidth < 1 || cropHeight < 1 ||
+        (startX + cropWidth) > srcWidth || (startY + cropHeight) > srcHeight ||
+        dstWidth < 1 || dstHeight < 1) {
+        return EIDSP_PARAMETER_INVALID;
+    }
+
+    const uint32_t src_x_frac = (cropWidth * FRAC_VAL) / dstWidth;
+    const uint32_t src_y_frac = (cropHeight * FRAC_VAL) / dstHeight;
+    const int stride = srcWidth * pixel_size_B;
+    uint32_t src_y_accum = 0;
+    uint8_t *d = dstImage;
+
+    for (int y = 0; y < dstHeight; y++) {
+        int ty = startY + (src_y_accum >> FRAC_BITS);
+        uint32_t y_frac = src_y_accum & FRAC_MASK;
+        uint32_t ny_frac = FRAC_VAL - y_frac;
+        src_y_accum += src_y_frac;
+
+        // neighbours outside the region are fine, outside the image they're clamped
+        const uint8_t *s0 = &srcImage[ty * stride];
+        const uint8_t *s1 = ty + 1 < srcHeight ? s0 + stride : s0;
+
+        uint32_t src_x_accum = 0;
+        for (int x = 0; x < dstWidth; x++) {
+            int tx = startX + (src_x_accum >> FRAC_BITS);
+            uint32_t x_frac = src_x_accum & FRAC_MASK;
+            uint32_t nx_frac = FRAC_VAL - x_frac;
+            src_x_accum += src_x_frac;
+
+            int ix0 = tx * pixel_size_B;
+            int ix1 = tx + 1 < srcWidth ? ix0 + pixel_size_B : ix0;
+
+            for (int color = 0; color < pixel_size_B; color++) {
+                uint32_t p00 = s0[ix0 + color];
+                uint32_t p10 = s0[ix1 + color];
+                uint32_t p01 = s1[ix0 + color];
+                uint32_t p11 = s1[ix1 + color];
+                p00 = ((p00 * nx_frac) + (p10 * x_frac) + FRAC_VAL / 2) >> FRAC_BITS; // top line
+                p01 = ((p01 * nx_frac) + (p11 * x_frac) + FRAC_VAL / 2) >> FRAC_BITS; // bottom line
+                p00 = ((p00 * ny_frac) + (p01 * y_frac) + FRAC_VAL / 2) >> FRAC_BITS; // top + bottom
+                *d++ = (uint8_t)p00;
+            }
+        }
+    }
+
+    return EIDSP_OK;
+}
+
 int resize_image_using_mode(
     const uint8_t *srcImage,
     int srcWidth,
@@ -192,6 +192,36 @@ int crop_and_interpolate_image(
     int dstHeight,
     int pixel_size_B);
 
+/**
+ * @brief Interpolates a region of an image to a desired new image size
+ * The region is read in place, so no intermediate crop buffer is needed
+ * Uses the same bilinear interpolation as resize_image
+ *
+ * @param srcImage Input image buffer
+ * @param srcWidth Input width in pixels
+ * @param srcHeight Input height in pixels
+ * @param startX X coordinate of the region in pixels
+ * @param startY Y coordinate of the region in pixels
+ * @param cropWidth Width of the region in pixels
+ * @param cropHeight Height of the region in pixels
+ * @param dstImage Output image buffer, must not overlap the input buffer
+ * @param dstWidth Desired new width in pixels
+ * @param dstHeight Desired new height in pixels
+ * @param pixel_size_B Size of pixels in Bytes.  3 for RGB, 1 for mono
+ */
+int crop_and_resize_image(
+    const uint8_t *srcImage,
+    int srcWidth,
+    int srcHeight,
+    int startX,
+    int startY,
+    int cropWidth,
+    int cropHeight,
+    uint8_t *dstImage,
+    int dstWidth,
+    int dstHeight,
+    int pixel_size_B);
+
 
 
 /**
@@ -569,6 +569,26 @@ typedef enum {
     DCT_NORMALIZATION_ORTHO
 } DCT_NORMALIZATION_MODE;
 
+/**
+ * Pixel layout of an image_view_t
+ */
+typedef enum {
+    EI_IMAGE_FORMAT_RGB888 = 0,         /**< 3 bytes per pixel, R first */
+    EI_IMAGE_FORMAT_GRAYSCALE = 1       /**< 1 byte per pixel */
+} ei_image_format_t;
+
+/**
+ * Read-only view on a byte-typed frame buffer, so image consumers can read pixels
+ * directly instead of going through the packed float representation of get_data()
+ */
+typedef struct {
+    const uint8_t *data;                /**< First byte of the top-left pixel */
+    uint32_t width;                     /**< Width in pixels */
+    uint32_t height;                    /**< Height in pixels */
+    uint32_t stride;                    /**< Bytes between the start of two rows */
+    ei_image_format_t format;
+} image_view_t;
+
 /**
  * @addtogroup ei_structs
  * @{
@@ -623,6 +643,14 @@ typedef struct ei_signal_t {
      *  preprocessing and inference.
     */
     size_t total_length;
+
+    /**
+     * Optional view on the raw frame buffer backing an image signal. When set,
+     * image feature extraction and the NPU input staging read the bytes directly,
+     * `get_data` is still required for every other consumer.
+     * It must describe exactly `total_length` pixels.
+    */
+    const image_view_t *image = nullptr;
 } signal_t;
 
 /** @} */
@@ -45,10 +45,17 @@
 /* Private variables ------------------------------------------------------- */
 static ATServer *at;
 
+extern void ei_uart_tx_init(void);
+extern void ei_uart_rx_init(void);
+extern bool ei_uart_rx_wait(uint32_t timeout_ms);
+
 extern "C" void ei_init(void)
 {
     EiDeviceStm32n6 *dev = static_cast<EiDeviceStm32n6*>(EiDeviceInfo::get_device());
 
+    ei_uart_tx_init();
+    ei_uart_rx_init();
+
     ei_printf("Type AT+HELP to see a list of commands.\r\n");
     ei_printf("Starting main loop\r\n");
 
@@ -60,6 +67,11 @@ extern "C" void ei_init(void)
 
 extern "C" void ei_main(void)
 {
+    /* nothing to run, sleep until a command comes in */
+    if (is_inference_running() == false) {
+        ei_uart_rx_wait(UINT32_MAX);
+    }
+
     /* handle command comming from uart */
     volatile char data = ei_getchar();
 
@@ -123,13 +123,59 @@ void base64_encode(const char *input, size_t input_size, void (*putc_f)(char))
     }
 }
 
-void base64_encode_chunk(const char *input, size_t input_size, void (*putc_f)(char))
+/**
+ * @brief Base64 encode and write to a bulk write function, in blocks of up to
+ * 256 output characters instead of one call per character
+ *
+ * @param input
+ * @param input_size
+ * @param write_f pointer to write function
+ */
+void base64_encode(const char *input, size_t input_size, void (*write_f)(const void *, size_t))
 {
-    static char leftover[3];
-    static uint8_t leftover_size = 0;
+    char output[256];
+    size_t output_ix = 0;
+
+    while (input_size >= 3) {
+        const unsigned char *in = (const unsigned char *)input;
+
+        output[output_ix++] = base64_chars[in[0] >> 2];
+        output[output_ix++] = base64_chars[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+        output[output_ix++] = base64_chars[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+        output[output_ix++] = base64_chars[in[2] & 0x3f];
+        input += 3;
+        input_size -= 3;
+
+        if (output_ix == sizeof(output)) {
+            write_f(output, output_ix);
+            output_ix = 0;
+        }
+    }
+
+    if (input_size) {
+        const unsigned char *in = (const unsigned char *)input;
+        unsigned char in1 = input_size > 1 ? in[1] : 0;
+
+        output[output_ix++] = base64_chars[in[0] >> 2];
+        output[output_ix++] = base64_chars[((in[0] & 0x03) << 4) | (in1 >> 4)];
+        output[output_ix++] = input_size > 1 ? base64_chars[(in1 & 0x0f) << 2] : '=';
+        output[output_ix++] = '=';
+    }
 
+    if (output_ix) {
+        write_f(output, output_ix);
+    }
+}
+
+/* bytes of the last chunk which did not make a full 3 byte group */
+static char leftover[3];
+static uint8_t leftover_size = 0;
+
+template<typename TSink>
+static void base64_encode_chunk_impl(const char *input, size_t input_size, TSink sink)
+{
     if (input == nullptr) {
-        base64_encode(leftover, leftover_size, putc_f);
+        base64_encode(leftover, leftover_size, sink);
         leftover_size = 0;
         return;
     }
@@ -145,27 +191,42 @@ void base64_encode_chunk(const char *input, size_t input_size, void (*putc_f)(ch
         if (leftover_size < 3) {
             return;
         }
-        base64_encode(leftover, leftover_size, putc_f);
+        base64_encode(leftover, leftover_size, sink);
         leftover_size = 0;
         input_size -= to_copy;
         input += to_copy;
     }
 
     if (input_size % 3 == 0) {
-        base64_encode(input, input_size, putc_f);
+        base64_encode(input, input_size, sink);
     }
     else {
         leftover_size = input_size % 3;
-        base64_encode(input, input_size - leftover_size, putc_f);
+        base64_encode(input, input_size - leftover_size, sink);
         memcpy(leftover, &input[input_size - leftover_size], leftover_size);
     }
 }
 
+void base64_encode_chunk(const char *input, size_t input_size, void (*putc_f)(char))
+{
+    base64_encode_chunk_impl(input, input_size, putc_f);
+}
+
+void base64_encode_chunk(const char *input, size_t input_size, void (*write_f)(const void *, size_t))
+{
+    base64_encode_chunk_impl(input, input_size, write_f);
+}
+
 void base64_encode_finish(void (*putc_f)(char))
 {
     base64_encode_chunk(nullptr, 0, putc_f);
 }
 
+void base64_encode_finish(void (*write_f)(const void *, size_t))
+{
+    base64_encode_chunk(nullptr, 0, write_f);
+}
+
 /**
  * @brief Base64 encode and write to output buffer, errors on buffer overflow
  *
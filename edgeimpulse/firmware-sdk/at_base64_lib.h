@@ -70,6 +70,9 @@
 void base64_encode(const char *input, size_t input_size, void (*putc_f)(char));
 void base64_encode_chunk(const char *input, size_t input_size, void (*putc_f)(char));
 void base64_encode_finish(void (*putc_f)(char));
+void base64_encode(const char *input, size_t input_size, void (*write_f)(const void *, size_t));
+void base64_encode_chunk(const char *input, size_t input_size, void (*write_f)(const void *, size_t));
+void base64_encode_finish(void (*write_f)(const void *, size_t));
 int base64_encode_buffer(const char *input, size_t input_size, char *output, size_t output_size);
 std::vector<unsigned char> base64_decode(std::string const&);
 
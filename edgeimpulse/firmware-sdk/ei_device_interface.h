@@ -35,6 +35,8 @@
 #ifndef EI_DEVICE_INTERFACE_H
 #define EI_DEVICE_INTERFACE_H
 
+#include <cstddef>
+
 /* Function prototypes ----------------------------------------------------- */
 //TODO: remove as it is device specific and wil be superseded by AT Server
 void ei_command_line_handle(void);
@@ -46,6 +48,9 @@ void ei_serial_setup(void);
 //TODO: remove as it is device specific
 void ei_write_string(char *data, int length);
 
+/* bulk write to the serial port, C linkage so the libc console can share it */
+extern "C" void ei_write(const void *data, size_t length);
+
 //TODO: move to a one header with all method requied by FW SDK
 char ei_getchar();
 
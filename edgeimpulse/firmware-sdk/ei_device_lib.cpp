@@ -37,6 +37,7 @@
 #include "ei_device_info_lib.h"
 #include "ei_device_memory.h"
 #include "ei_device_interface.h"
+#include "ei_transport_lib.h"
 
 #include "edge-impulse-sdk/classifier/ei_classifier_types.h"
 #include "edge-impulse-sdk/classifier/ei_signal_with_axes.h"
@@ -82,6 +83,8 @@ __attribute__((weak)) bool read_encode_send_sample_buffer(size_t address, size_t
     const int buffer_size = 513;
     uint8_t* buffer = (uint8_t*)ei_malloc(buffer_size);
 
+    ei_transport_begin(EI_TRANSPORT_FRAME_SAMPLE);
+
     while (1) {
         size_t bytes_to_read = buffer_size;
 
@@ -90,16 +93,19 @@ __attribute__((weak)) bool read_encode_send_sample_buffer(size_t address, size_t
         }
 
         if (bytes_to_read == 0) {
+            ei_transport_end();
             ei_free(buffer);
             return true;
         }
 
         if (memory->read_sample_data(buffer, address, bytes_to_read) != bytes_to_read) {
+            // flush the encoder state, it would otherwise carry into the next payload
+            ei_transport_end();
             ei_free(buffer);
             return false;
         }
 
-        base64_encode((char *)buffer, bytes_to_read, ei_putchar);
+        ei_transport_write(buffer, bytes_to_read);
 
         address += bytes_to_read;
         length -= bytes_to_read;
@@ -49,7 +49,8 @@ bool ei_user_invoke_stop_lib(void);
 
 /**
  * @brief Helper function for sending a data from memory over the
- * serial port. Data are encoded into base64 on the fly.
+ * serial port. Data are encoded into base64 on the fly, or sent as
+ * binary frames when the binary transport is selected.
  *
  * @param address address of samples
  * @param length number of samples (bytes)
@@ -51,6 +51,7 @@
 #include "firmware-sdk/at_base64_lib.h"
 #include "firmware-sdk/ei_device_interface.h"
 #include "firmware-sdk/ei_image_lib.h"
+#include "firmware-sdk/ei_transport_lib.h"
 
 // *********************************** AT cmd functions ***************
 
@@ -186,10 +187,10 @@ static bool ei_camera_take_snapshot_encode_and_output_no_init(size_t width, size
 #endif
 
     // recalculate size b/c now we want to send just the interpolated bytes
-    base64_encode(
-        reinterpret_cast<char *>(image),
-        final_height * final_width * pixel_size_B,
-        ei_putchar);
+    ei_transport_begin(pixel_size_B == RGB888_B_SIZE ? EI_TRANSPORT_FRAME_RGB888 : EI_TRANSPORT_FRAME_GRAYSCALE);
+    ei_transport_write_image_header(final_width, final_height);
+    ei_transport_write(image, final_height * final_width * pixel_size_B);
+    ei_transport_end();
 
     return true;
 }
@@ -245,7 +246,10 @@ extern bool ei_camera_start_snapshot_stream(size_t width, size_t height, bool us
 
     while (!ei_user_invoke_stop_lib()) {
         isOK &= ei_camera_take_snapshot_encode_and_output_no_init(width, height);
-        ei_printf("\r\n");
+        // frames are self delimiting
+        if (!ei_transport_is_binary()) {
+            ei_printf("\r\n");
+        }
     }
     camera->deinit();
 
@@ -0,0 +1,214 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include "ei_transport_lib.h"
+#include "at_base64_lib.h"
+#include "ei_device_interface.h"
+#include <cstring>
+
+/* Private variables ------------------------------------------------------- */
+static ei_transport_mode_t transport_mode = EI_TRANSPORT_BASE64;
+static uint16_t transport_sequence = 0;
+
+/* payload in progress between ei_transport_begin and ei_transport_end */
+static ei_transport_frame_type_t stream_type;
+static uint8_t stream_buffer[EI_TRANSPORT_FRAGMENT_SIZE];
+static size_t stream_length = 0;
+
+static uint32_t crc_table[256];
+static bool crc_table_ready = false;
+
+/* Private functions ------------------------------------------------------- */
+static void crc_table_init(void)
+{
+    for (uint32_t ix = 0; ix < 256; ix++) {
+        uint32_t c = ix;
+        for (int bit = 0; bit < 8; bit++) {
+            c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+        }
+        crc_table[ix] = c;
+    }
+    crc_table_ready = true;
+}
+
+static inline void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static inline void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+static void send_frame(ei_transport_frame_type_t type, uint8_t flags, const void *data, size_t length)
+{
+    uint8_t header[EI_TRANSPORT_HEADER_SIZE];
+    uint8_t trailer[EI_TRANSPORT_CRC_SIZE];
+
+    header[0] = EI_TRANSPORT_SYNC_0;
+    header[1] = EI_TRANSPORT_SYNC_1;
+    header[2] = (uint8_t)type;
+    header[3] = flags;
+    put_le16(&header[4], transport_sequence);
+    put_le32(&header[6], (uint32_t)length);
+
+    // sync bytes are not covered, so a receiver can check a frame found at any offset
+    uint32_t crc = ei_transport_crc32(0, &header[2], EI_TRANSPORT_HEADER_SIZE - 2);
+    crc = ei_transport_crc32(crc, data, length);
+    put_le32(trailer, crc);
+
+    ei_write(header, sizeof(header));
+    ei_write(data, length);
+    ei_write(trailer, sizeof(trailer));
+}
+
+/* Public functions -------------------------------------------------------- */
+void ei_transport_set_mode(ei_transport_mode_t mode)
+{
+    transport_mode = mode;
+}
+
+ei_transport_mode_t ei_transport_get_mode(void)
+{
+    return transport_mode;
+}
+
+bool ei_transport_is_binary(void)
+{
+    return transport_mode == EI_TRANSPORT_BINARY;
+}
+
+/**
+ * @brief Update a CRC-32 (IEEE 802.3, as zlib) with more data, start with crc = 0
+ */
+uint32_t ei_transport_crc32(uint32_t crc, const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    if (!crc_table_ready) {
+        crc_table_init();
+    }
+
+    crc = ~crc;
+    while (length--) {
+        crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+void ei_transport_send(ei_transport_frame_type_t type, const void *data, size_t length)
+{
+    if (transport_mode == EI_TRANSPORT_BASE64) {
+        base64_encode((const char *)data, length, ei_write);
+        return;
+    }
+
+    send_frame(type, 0, data, length);
+    transport_sequence++;
+}
+
+void ei_transport_begin(ei_transport_frame_type_t type)
+{
+    stream_type = type;
+    stream_length = 0;
+}
+
+void ei_transport_write(const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    if (transport_mode == EI_TRANSPORT_BASE64) {
+        base64_encode_chunk((const char *)data, length, ei_write);
+        return;
+    }
+
+    while (length > 0) {
+        // whole fragments straight from the caller's buffer
+        if (stream_length == 0 && length > EI_TRANSPORT_FRAGMENT_SIZE) {
+            send_frame(stream_type, EI_TRANSPORT_FLAG_MORE, p, EI_TRANSPORT_FRAGMENT_SIZE);
+            p += EI_TRANSPORT_FRAGMENT_SIZE;
+            length -= EI_TRANSPORT_FRAGMENT_SIZE;
+            continue;
+        }
+
+        size_t chunk = EI_TRANSPORT_FRAGMENT_SIZE - stream_length;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(&stream_buffer[stream_length], p, chunk);
+        stream_length += chunk;
+        p += chunk;
+        length -= chunk;
+
+        // keep a full buffer until more data shows up, it may be the last fragment
+        if (stream_length == EI_TRANSPORT_FRAGMENT_SIZE && length > 0) {
+            send_frame(stream_type, EI_TRANSPORT_FLAG_MORE, stream_buffer, stream_length);
+            stream_length = 0;
+        }
+    }
+}
+
+void ei_transport_end(void)
+{
+    if (transport_mode == EI_TRANSPORT_BASE64) {
+        base64_encode_finish(ei_write);
+        return;
+    }
+
+    send_frame(stream_type, 0, stream_buffer, stream_length);
+    stream_length = 0;
+    transport_sequence++;
+}
+
+void ei_transport_write_image_header(uint16_t width, uint16_t height)
+{
+    uint8_t header[4];
+
+    // base64 output stays pixels only
+    if (transport_mode == EI_TRANSPORT_BASE64) {
+        return;
+    }
+
+    put_le16(&header[0], width);
+    put_le16(&header[2], height);
+    ei_transport_write(header, sizeof(header));
+}
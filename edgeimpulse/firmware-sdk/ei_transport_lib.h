@@ -0,0 +1,115 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EI_TRANSPORT_LIB_H
+#define EI_TRANSPORT_LIB_H
+
+/* Include ----------------------------------------------------------------- */
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Serial transport for bulk data (snapshots, sample reads, debug framebuffers).
+ *
+ * In the default base64 mode payloads are sent as base64 text, as before. In binary
+ * mode (opt-in through AT+TRANSPORT) every payload goes out as one or more frames:
+ *
+ *   offset  size  field
+ *   0       2     sync, 0xEB 0x90
+ *   2       1     payload type, ei_transport_frame_type_t
+ *   3       1     flags, EI_TRANSPORT_FLAG_*
+ *   4       2     sequence number, shared by the fragments of one payload
+ *   6       4     payload length in this frame
+ *   10      n     payload
+ *   10 + n  4     CRC-32 (IEEE 802.3) of bytes 2 .. 10 + n - 1
+ *
+ * All fields are little endian. Payloads of unknown size are split in fragments of at
+ * most EI_TRANSPORT_FRAGMENT_SIZE bytes, all but the last one flagged MORE.
+ * Raw image payloads start with a uint16 width and a uint16 height.
+ */
+
+/* Constants --------------------------------------------------------------- */
+#define EI_TRANSPORT_SYNC_0             0xEB
+#define EI_TRANSPORT_SYNC_1             0x90
+#define EI_TRANSPORT_HEADER_SIZE        10
+#define EI_TRANSPORT_CRC_SIZE           4
+
+/* more fragments of the same payload follow */
+#define EI_TRANSPORT_FLAG_MORE          0x01
+
+#ifndef EI_TRANSPORT_FRAGMENT_SIZE
+#define EI_TRANSPORT_FRAGMENT_SIZE      4096
+#endif
+
+typedef enum {
+    EI_TRANSPORT_BASE64 = 0,
+    EI_TRANSPORT_BINARY
+} ei_transport_mode_t;
+
+typedef enum {
+    /* raw bytes of the sample storage */
+    EI_TRANSPORT_FRAME_SAMPLE = 1,
+    EI_TRANSPORT_FRAME_JPEG = 2,
+    EI_TRANSPORT_FRAME_RGB888 = 3,
+    EI_TRANSPORT_FRAME_GRAYSCALE = 4,
+    /* inference result record */
+    EI_TRANSPORT_FRAME_RESULT = 5
+} ei_transport_frame_type_t;
+
+/* Function prototypes ----------------------------------------------------- */
+void ei_transport_set_mode(ei_transport_mode_t mode);
+ei_transport_mode_t ei_transport_get_mode(void);
+bool ei_transport_is_binary(void);
+
+/**
+ * @brief Send a complete payload, as one frame or as base64
+ */
+void ei_transport_send(ei_transport_frame_type_t type, const void *data, size_t length);
+
+/**
+ * @brief Send a payload whose size is not known upfront: begin, any number of
+ * writes, end. Only one payload can be in progress at a time.
+ */
+void ei_transport_begin(ei_transport_frame_type_t type);
+void ei_transport_write(const void *data, size_t length);
+void ei_transport_end(void);
+
+/**
+ * @brief Send the width and height header of a raw image payload
+ */
+void ei_transport_write_image_header(uint16_t width, uint16_t height);
+
+uint32_t ei_transport_crc32(uint32_t crc, const void *data, size_t length);
+
+#endif /* EI_TRANSPORT_LIB_H */
@@ -45,6 +45,7 @@
 #include "edge-impulse-sdk/dsp/numpy_types.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include "firmware-sdk/at_base64_lib.h"
+#include "firmware-sdk/ei_transport_lib.h"
 
 using namespace ei;
 
@@ -83,20 +84,31 @@ int encode_as_jpg(uint8_t *framebuffer, size_t framebuffer_size, int width, int
 }
 
 int32_t jpeg_write_callback (JPEGFILE *pFile, uint8_t *pBuf, int32_t iLen) {
-    base64_encode_chunk((const char *)pBuf, iLen, ei_putchar);
+    ei_transport_write(pBuf, iLen);
     return 0;
 }
 
 void jpeg_close_callback(JPEGFILE *pFile) {
-    base64_encode_finish(ei_putchar);
+    ei_transport_end();
 }
 
 void* jpeg_open_callback (const char *szFilename) {
+    ei_transport_begin(EI_TRANSPORT_FRAME_JPEG);
     // file handle isn't used in the internals, just return non NULL.
     return (void *)1;
 }
 
+static int encode_frame_as_jpg_common(const uint8_t *frame, int width, int height, int stride, uint8_t pixel_type, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly);
+
 static int encode_bw_signal_as_jpg_common(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly) {
+    // the signal is backed by a frame buffer, encode it without the float round trip
+    if (signal->image && signal->image->data && signal->image->format == EI_IMAGE_FORMAT_GRAYSCALE &&
+        (int)signal->image->width == width && (int)signal->image->height == height) {
+        const image_view_t *image = signal->image;
+        return encode_frame_as_jpg_common(image->data, width, height, image->stride,
+            JPEG_PIXEL_GRAYSCALE, out_buffer, out_buffer_size, out_size, output_directly);
+    }
+
     static JPEGClass jpg;
     JPEGENCODE jpe;
     float *encode_buffer = NULL;
@@ -196,6 +208,14 @@ int encode_bw_signal_as_jpg_and_output_base64(signal_t *signal, int width, int h
 
 
 static int encode_rgb888_signal_as_jpg_common(signal_t *signal, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly) {
+    // the signal is backed by a frame buffer, encode it without the float round trip
+    if (signal->image && signal->image->data && signal->image->format == EI_IMAGE_FORMAT_RGB888 &&
+        (int)signal->image->width == width && (int)signal->image->height == height) {
+        const image_view_t *image = signal->image;
+        return encode_frame_as_jpg_common(image->data, width, height, image->stride,
+            JPEG_PIXEL_RGB888, out_buffer, out_buffer_size, out_size, output_directly);
+    }
+
     static JPEGClass jpg;
     JPEGENCODE jpe;
     float *encode_buffer = NULL;
@@ -416,5 +436,142 @@ int encode_rgb565_signal_as_jpg_and_output_base64(signal_t *signal, int width, i
     return encode_rgb565_signal_as_jpg_common(signal, width, height, NULL, 0, NULL, true);
 }
 
+/**
+ * Encode a raw frame as JPEG. The frame is walked one 8 row strip at a time, each strip is
+ * read (and converted to the byte order the encoder expects) once and then handed to addMCU
+ * for all MCUs in it, instead of paging every MCU through a float signal.
+ *
+ * pixel_type is JPEG_PIXEL_GRAYSCALE, JPEG_PIXEL_RGB565 (little endian words) or
+ * JPEG_PIXEL_RGB888 (R, G, B byte order, as produced by the camera).
+ * stride is the distance in bytes between two rows of the frame.
+ */
+static int encode_frame_as_jpg_common(const uint8_t *frame, int width, int height, int stride, uint8_t pixel_type, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size, bool output_directly) {
+    static JPEGClass jpg;
+    JPEGENCODE jpe;
+    uint8_t *strip_buffer = NULL;
+    uint8_t *strip = NULL;
+
+    int rc;
+    if (output_directly) {
+        rc = jpg.open("image.jpg", jpeg_open_callback, jpeg_close_callback, NULL, jpeg_write_callback, NULL);
+    } else {
+        rc = jpg.open(out_buffer, out_buffer_size);
+    }
+    if (rc != JPEG_SUCCESS) {
+        return rc;
+    }
+
+    rc = jpg.encodeBegin(&jpe, width, height, pixel_type, JPEG_SUBSAMPLE_444, JPEG_Q_BEST);
+    if (rc != JPEG_SUCCESS) {
+        // nothing was encoded, close the payload opened by jpeg_open_callback
+        if (output_directly) {
+            ei_transport_end();
+        }
+        return rc;
+    }
+
+    int imcu_count = ((width + jpe.cx-1)/ jpe.cx) * ((height + jpe.cy-1) / jpe.cy);
+
+    int bytePp = (pixel_type == JPEG_PIXEL_RGB888) ? 3 : (pixel_type == JPEG_PIXEL_RGB565) ? 2 : 1;
+    int pitch = bytePp * width;
+    int strip_y = -1;
+
+    // one strip of MCU height, only used when the frame can't be passed as is
+    // (MCUs are always sampled 8x8, pad so the last one of a partial row stays in bounds)
+    strip_buffer = (uint8_t*)ei_calloc(1, pitch * jpe.cy + jpe.cx * bytePp);
+    if (!strip_buffer) {
+        rc = JPEG_MEM_ERROR;
+        goto cleanup;
+    }
+
+    for (int i = 0; i < imcu_count; i++) {
+        // the JPEGENCODE structure is updated by addMCU() after
+        // each call, fetch a new strip when it moves down a row of MCUs
+        if (jpe.y != strip_y) {
+            strip_y = jpe.y;
+            int rows = (height - strip_y < jpe.cy) ? (height - strip_y) : jpe.cy;
+            const uint8_t *src = &frame[strip_y * stride];
+
+            if (pixel_type == JPEG_PIXEL_RGB888) {
+                // jpeg library expects BGR (LE)
+                for (int row = 0; row < rows; row++) {
+                    const uint8_t *src_row = &src[row * stride];
+                    uint8_t *dst_row = &strip_buffer[row * pitch];
+                    for (int ix = 0; ix < width; ix++) {
+                        dst_row[ix * 3 + 2] = src_row[ix * 3 + 0];  // r
+                        dst_row[ix * 3 + 1] = src_row[ix * 3 + 1];  // g
+                        dst_row[ix * 3 + 0] = src_row[ix * 3 + 2];  // b
+                    }
+                }
+                strip = strip_buffer;
+            }
+            else if (rows < jpe.cy || (width % jpe.cx) != 0 || stride != pitch) {
+                // partial strip or MCU, or padded rows, don't let the encoder read past the frame
+                for (int row = 0; row < rows; row++) {
+                    memcpy(&strip_buffer[row * pitch], &src[row * stride], pitch);
+                }
+                strip = strip_buffer;
+            }
+            else {
+                strip = (uint8_t *)src;
+            }
+        }
+
+        // pass a pointer to the upper left corner of each MCU
+        rc = jpg.addMCU(&jpe, &strip[jpe.x * bytePp], pitch);
+        if (rc != JPEG_SUCCESS) {
+            goto cleanup;
+        }
+    }
+
+    rc = JPEG_SUCCESS;
+
+cleanup:
+    if (output_directly)
+        jpg.close();
+    else
+        *out_size = jpg.close();
+
+    if (strip_buffer) ei_free(strip_buffer);
+
+    return rc;
+}
+
+int encode_bw_frame_as_jpg(const uint8_t *frame, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size) {
+    return encode_frame_as_jpg_common(frame, width, height, width, JPEG_PIXEL_GRAYSCALE, out_buffer, out_buffer_size, out_size, false);
+}
+
+int encode_bw_frame_as_jpg_and_output_base64(const uint8_t *frame, int width, int height) {
+    return encode_frame_as_jpg_common(frame, width, height, width, JPEG_PIXEL_GRAYSCALE, NULL, 0, NULL, true);
+}
+
+int encode_rgb888_frame_as_jpg(const uint8_t *frame, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size) {
+    return encode_frame_as_jpg_common(frame, width, height, width * 3, JPEG_PIXEL_RGB888, out_buffer, out_buffer_size, out_size, false);
+}
+
+int encode_rgb888_frame_as_jpg_and_output_base64(const uint8_t *frame, int width, int height) {
+    return encode_frame_as_jpg_common(frame, width, height, width * 3, JPEG_PIXEL_RGB888, NULL, 0, NULL, true);
+}
+
+int encode_rgb565_frame_as_jpg(const uint8_t *frame, int width, int height, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size) {
+    return encode_frame_as_jpg_common(frame, width, height, width * 2, JPEG_PIXEL_RGB565, out_buffer, out_buffer_size, out_size, false);
+}
+
+int encode_rgb565_frame_as_jpg_and_output_base64(const uint8_t *frame, int width, int height) {
+    return encode_frame_as_jpg_common(frame, width, height, width * 2, JPEG_PIXEL_RGB565, NULL, 0, NULL, true);
+}
+
+/**
+ * Encode a byte-typed image view (RGB888 or grayscale, rows may be padded) as JPEG
+ */
+int encode_image_view_as_jpg(const image_view_t *image, uint8_t *out_buffer, size_t out_buffer_size, size_t *out_size) {
+    uint8_t pixel_type = image->format == EI_IMAGE_FORMAT_RGB888 ? JPEG_PIXEL_RGB888 : JPEG_PIXEL_GRAYSCALE;
+    return encode_frame_as_jpg_common(image->data, image->width, image->height, image->stride, pixel_type, out_buffer, out_buffer_size, out_size, false);
+}
+
+int encode_image_view_as_jpg_and_output_base64(const image_view_t *image) {
+    uint8_t pixel_type = image->format == EI_IMAGE_FORMAT_RGB888 ? JPEG_PIXEL_RGB888 : JPEG_PIXEL_GRAYSCALE;
+    return encode_frame_as_jpg_common(image->data, image->width, image->height, image->stride, pixel_type, NULL, 0, NULL, true);
+}
 
 #endif // ENCODE_AS_JPG_H
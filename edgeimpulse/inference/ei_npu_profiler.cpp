@@ -0,0 +1,345 @@
+/* The Clear BSD License
+ *
+ * Copyright (c) 2025 EdgeImpulse Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ *   * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ *   * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+
+#include "ei_npu_profiler.h"
+#include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+#if EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON
+#include "stm32n6xx_hal.h"
+#include "ll_aton_runtime.h"
+#if defined(ATON_DEBUG_TRACE_NUM)
+#include "ll_aton_dbgtrc.h"
+#endif
+
+#ifndef EI_NPU_PROFILER_MAX_EPOCH_BLOCKS
+#define EI_NPU_PROFILER_MAX_EPOCH_BLOCKS    128
+#endif
+
+/* First of the 16 debug & trace counters used for the bus transfer statistics */
+#define EI_NPU_PROFILER_DBGTRC_COUNTER      0
+
+typedef struct {
+    uint32_t flags;
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint64_t total_read_bytes;
+    uint64_t total_write_bytes;
+} ei_npu_profiler_block_t;
+
+/* Defined in inferencing_engines/aton.h, next to the network instance */
+extern void ei_aton_set_epoch_callback(TraceEpochBlock_FuncPtr_t callback);
+
+static ei_npu_profiler_block_t blocks[EI_NPU_PROFILER_MAX_EPOCH_BLOCKS];
+static uint32_t block_count = 0;
+static uint32_t dropped_blocks = 0;
+
+static bool profiler_armed = false;
+static bool callback_registered = false;
+static uint32_t inferences_requested = 0;
+static uint32_t inferences_done = 0;
+
+/* State of the epoch block being executed */
+static uint32_t block_ix = 0;
+static uint32_t block_start_cycles = 0;
+static uint32_t block_start_reads = 0;
+static uint32_t block_start_writes = 0;
+
+static void epoch_callback(LL_ATON_RT_Callbacktype_t ctype, const NN_Instance_TypeDef *nn_instance,
+    const EpochBlock_ItemTypeDef *eb);
+static void print_report(void);
+
+static inline void read_bus_transfers(uint32_t *writes, uint32_t *reads)
+{
+#if defined(ATON_DEBUG_TRACE_NUM)
+    unsigned int w, r;
+    LL_Dbgtrc_GetTotalTranfers(EI_NPU_PROFILER_DBGTRC_COUNTER, &w, &r);
+    *writes = w;
+    *reads = r;
+#else
+    *writes = 0;
+    *reads = 0;
+#endif
+}
+
+/**
+ * @brief Arm the profiler for the given number of inferences.
+ * The epoch callback is registered by the inference loop, between two inferences,
+ * as the runtime does not allow changing it while the network is executing.
+ *
+ * @param inferences number of inferences to accumulate before the report is printed
+ * @return true if the profiler was armed
+ */
+bool ei_npu_profiler_start(uint32_t inferences)
+{
+    if (inferences == 0) {
+        return false;
+    }
+
+    memset(blocks, 0, sizeof(blocks));
+    block_count = 0;
+    dropped_blocks = 0;
+    block_ix = 0;
+    inferences_requested = inferences;
+    inferences_done = 0;
+
+    /* TRCENA is set at startup, make sure the cycle counter itself is running */
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+#if defined(ATON_DEBUG_TRACE_NUM)
+    LL_Dbgtrc_BurstLenBenchStart(EI_NPU_PROFILER_DBGTRC_COUNTER);
+#endif
+
+    profiler_armed = true;
+
+    return true;
+}
+
+/**
+ * @brief Disarm the profiler and detach it from the runtime, without printing a report
+ */
+void ei_npu_profiler_stop(void)
+{
+    profiler_armed = false;
+
+    if (callback_registered) {
+        ei_aton_set_epoch_callback(NULL);
+        callback_registered = false;
+    }
+
+#if defined(ATON_DEBUG_TRACE_NUM)
+    LL_Dbgtrc_Deinit(0);
+#endif
+}
+
+bool ei_npu_profiler_is_running(void)
+{
+    return profiler_armed;
+}
+
+/**
+ * @brief Called by the inference loop right before the network is run
+ */
+void ei_npu_profiler_begin_inference(void)
+{
+    if (!profiler_armed) {
+        return;
+    }
+
+    if (!callback_registered) {
+        ei_aton_set_epoch_callback(epoch_callback);
+        callback_registered = true;
+    }
+
+    block_ix = 0;
+}
+
+/**
+ * @brief Called by the inference loop once the network has finished
+ *
+ * @return true when the requested number of inferences has been profiled,
+ *         the report has been printed and the profiler is disarmed
+ */
+bool ei_npu_profiler_end_inference(void)
+{
+    if (!profiler_armed) {
+        return false;
+    }
+
+    if (block_ix > block_count) {
+        block_count = block_ix;
+    }
+
+    if (++inferences_done < inferences_requested) {
+        return false;
+    }
+
+    ei_npu_profiler_stop();
+    print_report();
+
+    return true;
+}
+
+/**
+ * @brief Epoch block callback, called from the inference thread by the ATON runtime.
+ * Blocks are identified by their position in the schedule, which is fixed for a network.
+ */
+static void epoch_callback(LL_ATON_RT_Callbacktype_t ctype, const NN_Instance_TypeDef *nn_instance,
+    const EpochBlock_ItemTypeDef *eb)
+{
+    (void)nn_instance;
+
+    switch (ctype) {
+        case LL_ATON_RT_Callbacktype_PRE_START:
+            read_bus_transfers(&block_start_writes, &block_start_reads);
+            block_start_cycles = DWT->CYCCNT;
+            break;
+
+        case LL_ATON_RT_Callbacktype_POST_END: {
+            uint32_t cycles = DWT->CYCCNT - block_start_cycles;
+            uint32_t writes, reads;
+            read_bus_transfers(&writes, &reads);
+
+            if (block_ix >= EI_NPU_PROFILER_MAX_EPOCH_BLOCKS) {
+                dropped_blocks++;
+                block_ix++;
+                break;
+            }
+
+            ei_npu_profiler_block_t *block = &blocks[block_ix++];
+            if (block->count == 0 || cycles < block->min_cycles) {
+                block->min_cycles = cycles;
+            }
+            if (cycles > block->max_cycles) {
+                block->max_cycles = cycles;
+            }
+            block->flags = eb->flags;
+            block->count++;
+            block->total_cycles += cycles;
+            block->total_read_bytes += reads - block_start_reads;
+            block->total_write_bytes += writes - block_start_writes;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+static const char *block_type(uint32_t flags)
+{
+    if (flags & EpochBlock_Flags_hybrid) {
+        return "HYB";
+    }
+    if (flags & EpochBlock_Flags_pure_sw) {
+        return "SW";
+    }
+    if (flags & EpochBlock_Flags_internal) {
+        return "INT";
+    }
+    return "HW";
+}
+
+static void print_report(void)
+{
+    const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    const uint32_t table_len = block_count < EI_NPU_PROFILER_MAX_EPOCH_BLOCKS ?
+        block_count : EI_NPU_PROFILER_MAX_EPOCH_BLOCKS;
+    uint64_t hw_cycles = 0;
+    uint64_t sw_cycles = 0;
+    uint32_t sw_blocks = 0;
+    uint64_t read_bytes = 0;
+    uint64_t write_bytes = 0;
+
+    ei_printf("NPU profile: %u inferences, %u epoch blocks, CPU %u MHz\r\n",
+        inferences_done, block_count, cycles_per_us);
+    ei_printf("  #  type   avg_us   min_us   max_us    rd_B/inf    wr_B/inf\r\n");
+
+    for (uint32_t i = 0; i < table_len; i++) {
+        const ei_npu_profiler_block_t *block = &blocks[i];
+
+        if (block->count == 0) {
+            continue;
+        }
+
+        uint32_t avg_cycles = (uint32_t)(block->total_cycles / block->count);
+
+        ei_printf("%3u  %-4s %8u %8u %8u %11u %11u\r\n",
+            i,
+            block_type(block->flags),
+            avg_cycles / cycles_per_us,
+            block->min_cycles / cycles_per_us,
+            block->max_cycles / cycles_per_us,
+            (uint32_t)(block->total_read_bytes / block->count),
+            (uint32_t)(block->total_write_bytes / block->count));
+
+        if (block->flags & (EpochBlock_Flags_pure_sw | EpochBlock_Flags_hybrid)) {
+            sw_cycles += block->total_cycles;
+            sw_blocks++;
+        }
+        else {
+            hw_cycles += block->total_cycles;
+        }
+        read_bytes += block->total_read_bytes;
+        write_bytes += block->total_write_bytes;
+    }
+
+    ei_printf("Per inference: HW %u us, SW fallback %u us in %u blocks, read %u B, written %u B\r\n",
+        (uint32_t)(hw_cycles / inferences_done / cycles_per_us),
+        (uint32_t)(sw_cycles / inferences_done / cycles_per_us),
+        sw_blocks,
+        (uint32_t)(read_bytes / inferences_done),
+        (uint32_t)(write_bytes / inferences_done));
+
+    if (dropped_blocks > 0) {
+        ei_printf("WARN: %u epoch blocks not recorded, increase EI_NPU_PROFILER_MAX_EPOCH_BLOCKS\r\n",
+            dropped_blocks / inferences_done);
+    }
+#if !defined(ATON_DEBUG_TRACE_NUM)
+    ei_printf("WARN: ATON debug & trace unit not available, bus transfers not recorded\r\n");
+#endif
+}
+
+#else
+
+bool ei_npu_profiler_start(uint32_t inferences)
+{
+    (void)inferences;
+    ei_printf("ERR: NPU profiling requires a model compiled for the NPU\r\n");
+    return false;
+}
+
+void ei_npu_profiler_stop(void)
+{
+}
+
+bool ei_npu_profiler_is_running(void)
+{
+    return false;
+}
+
+void ei_npu_profiler_begin_inference(void)
+{
+}
+
+bool ei_npu_profiler_end_inference(void)
+{
+    return false;
+}
+
+#endif /* EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON */
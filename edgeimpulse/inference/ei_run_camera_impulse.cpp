@@ -36,11 +36,16 @@
 #if defined(EI_CLASSIFIER_SENSOR) && (EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_CAMERA)
 #include "edge-impulse-sdk/classifier/ei_run_classifier.h"
 #include "edge-impulse-sdk/dsp/image/image.hpp"
+#include "edge-impulse-sdk/classifier/ei_nms.h"
 #include "firmware-sdk/ei_camera_interface.h"
 #include "ingestion-sdk-platform/sensor/ei_camera.h"
 #include "firmware-sdk/at_base64_lib.h"
 #include "firmware-sdk/jpeg/encode_as_jpg.h"
+#include "firmware-sdk/ei_transport_lib.h"
 #include "firmware-sdk/ei_device_info_lib.h"
+#include "firmware-sdk/QCBOR/inc/qcbor.h"
+#include "ei_npu_profiler.h"
+#include "ei_run_impulse.h"
 #include "../Objdetect_pp/lib_objdetect_pp/Inc/objdetect_pp_output_if.h"
 
 #include "utils.h"
@@ -61,8 +66,10 @@ static bool use_max_uart = false;
 
 EiSTCamera *camera = nullptr;
 
-uint8_t *snapshot_buf = nullptr;
+static uint8_t *snapshot_buf = nullptr;
 static uint32_t snapshot_buf_size;
+// model input image, the captured frame unless it was scaled out of place
+static uint8_t *image_buf = nullptr;
 
 static ei_device_snapshot_resolutions_t snapshot_resolution;
 
@@ -70,11 +77,101 @@ static bool resize_required = false;
 static bool crop_required = false;
 
 static uint32_t inference_delay = 1000;
+
+// NPU runs the next frame while the current one is decoded, results lag one frame behind
+static bool pipelined = false;
+// capture time and drops of the frame in the pipeline
+static uint32_t pipeline_frame_ts = 0;
+static uint32_t pipeline_frame_dropped = 0;
 static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr);
 static void local_display_results(ei_impulse_result_t* result);
+static void local_send_results_cbor(ei_impulse_result_t* result, uint32_t frame_ts, uint32_t frame_dropped);
+
+#ifndef EI_RESULT_CBOR_BUFFER_SIZE
+#define EI_RESULT_CBOR_BUFFER_SIZE  2048
+#endif
+
+// results as CBOR records instead of printed predictions
+static bool cbor_results = false;
+// results shown since the impulse was started
+static uint32_t result_frame_id = 0;
+static uint8_t result_cbor_buf[EI_RESULT_CBOR_BUFFER_SIZE];
 
 ei_impulse_result_t result = { 0 };
 
+// second stage classifier, nullptr when not cascading
+static ei_impulse_handle_t *cascade_handle = nullptr;
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+#ifndef EI_CASCADE_MAX_OBJECTS
+#define EI_CASCADE_MAX_OBJECTS      10
+#endif
+
+typedef struct {
+    const char *label;
+    float value;
+} ei_cascade_result_t;
+
+static float cascade_min_box_score = 0.5f;
+// top class of the second stage for each bounding box, label is nullptr for boxes it skipped
+static ei_cascade_result_t cascade_results[EI_CASCADE_MAX_OBJECTS];
+static ei_impulse_result_t cascade_result = { 0 };
+static uint32_t cascade_us = 0;
+// crop being classified, the NPU input buffer of the second network with ATON
+static uint8_t *cascade_buf = nullptr;
+
+static EI_IMPULSE_ERROR ei_cascade_run(const ei::image_view_t *frame, int roi_x, int roi_y, int roi_width, int roi_height);
+static int ei_cascade_get_data(size_t offset, size_t length, float *out_ptr);
+
+// region of interest capture, the region grows by this fraction of its size on every side
+#ifndef EI_ROI_MARGIN
+#define EI_ROI_MARGIN               0.25f
+#endif
+
+// area of the full field of view, as a fraction (0 to 1) of it
+typedef struct {
+    float x;
+    float y;
+    float width;
+    float height;
+} ei_roi_t;
+
+static const ei_roi_t roi_full_view = { 0.0f, 0.0f, 1.0f, 1.0f };
+// full view every roi_interval frames, 0 when region of interest capture is disabled
+static uint32_t roi_interval = 0;
+static bool roi_running = false;
+static uint32_t roi_frames = 0;
+// region the current frame was captured from, and the region around its objects
+static ei_roi_t roi_view = roi_full_view;
+static ei_roi_t roi_next = roi_full_view;
+static bool roi_next_valid = false;
+
+static void ei_roi_select(void);
+static EI_IMPULSE_ERROR ei_roi_update(void);
+
+// tiled inference: the full view is split in tile_cols x tile_rows overlapping tiles, each
+// captured by its own frame, followed by a full view frame for objects larger than a tile
+static uint32_t tile_cols = 0;
+static uint32_t tile_rows = 0;
+static float tile_overlap = 0.0f;
+static bool tiles_running = false;
+// tile of the current frame, tile_cols * tile_rows is the full view
+static uint32_t tile_index = 0;
+// detections of the pass so far in full view coordinates, [y1, x1, y2, x2] per box
+static std::vector<float> tile_boxes;
+static std::vector<float> tile_scores;
+static std::vector<int> tile_classes;
+static std::vector<int> tile_selected;
+static std::vector<ei_impulse_result_bounding_box_t> tile_results;
+// boxes of the last complete pass, shown while the tiles of the next one run
+static ei_impulse_result_bounding_box_t *tile_shown_boxes = nullptr;
+static uint32_t tile_shown_count = 0;
+
+static void ei_tiles_select(void);
+static bool ei_tiles_update(void);
+#endif
+static int compareString(const char *str, const char *array[], int size);
+
 /**
  * @brief 
  * 
@@ -90,6 +187,7 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
     debug_mode = debug;
     continuous_mode = debug? true : continuous;
     use_max_uart = use_max_uart_speed;
+    result_frame_id = 0;
 
     if (camera->is_camera_present() == false) {
         ei_printf("ERR: Failed to start inference, camera is missing!\n");
@@ -117,6 +215,38 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
 
     snapshot_buf_size = snapshot_resolution.width * snapshot_resolution.height * 3;
 
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    // the region is scaled by the DCMIPP, the frame must be the model input as is
+    roi_running = roi_interval > 0 && !crop_required && !resize_required;
+    if (roi_interval > 0 && !roi_running) {
+        ei_printf("WARN: Camera can't output %ux%u, region of interest capture disabled\n",
+            EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT);
+    }
+    roi_frames = 0;
+    roi_next_valid = false;
+
+    // tiles are cropped by the DCMIPP too. They replace region of interest capture,
+    // and the second stage that runs on the boxes of a single inference
+    tiles_running = tile_cols > 0 && !crop_required && !resize_required;
+    if (tile_cols > 0 && !tiles_running) {
+        ei_printf("WARN: Camera can't output %ux%u, tiled inference disabled\n",
+            EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT);
+    }
+    else if (tiles_running && cascade_handle) {
+        ei_printf("WARN: Second stage classifier is not run on tiles, tiled inference disabled\n");
+        tiles_running = false;
+    }
+    if (tiles_running) {
+        roi_running = false;
+    }
+    tile_index = 0;
+    tile_boxes.clear();
+    tile_scores.clear();
+    tile_classes.clear();
+    tile_shown_boxes = nullptr;
+    tile_shown_count = 0;
+#endif
+
     // summary of inferencing settings (from model_metadata.h)
     ei_printf("Inferencing settings:\n");
     ei_printf("\tImage resolution: %dx%d\n", EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT);
@@ -126,6 +256,20 @@ void ei_start_impulse(bool continuous, bool debug, bool use_max_uart_speed)
     if (continuous_mode == true) {
         inference_delay = 0;
         state = INFERENCE_DATA_READY;
+        // capture the next frame while the current one is being processed.
+        // Not with region of interest capture, the crop changes between two snapshots
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+        if (!roi_running && !tiles_running)
+#endif
+        {
+            camera->start_stream();
+#if EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON
+            // not with a second stage or the profiler, both need the NPU between two frames,
+            // nor while debugging, the framebuffer printed would not match the result
+            pipelined = !debug_mode && cascade_handle == nullptr && !ei_npu_profiler_is_running() &&
+                ei_aton_set_pipelined(true);
+#endif
+        }
     }
     else {
         inference_delay = 2000;
@@ -161,6 +305,29 @@ void ei_stop_impulse(void)
         ei_printf("Stopping inferencing...\n");
     }
 
+    camera->stop_stream();
+
+#if EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON
+    if (pipelined) {
+        ei_aton_set_pipelined(false);
+        pipelined = false;
+    }
+#endif
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    if (roi_running || tiles_running) {
+        roi_view = roi_full_view;
+        camera->set_roi(&roi_view.x, &roi_view.y, &roi_view.width, &roi_view.height);
+        roi_running = false;
+        tiles_running = false;
+    }
+#endif
+
+    // interrupted before all the requested inferences were profiled
+    if (ei_npu_profiler_is_running()) {
+        ei_npu_profiler_stop();
+    }
+
     state = INFERENCE_STOPPED;
 }
 
@@ -179,26 +346,102 @@ void ei_run_impulse(void)
             break;
     }    
 
-    bool isOK = camera->ei_camera_capture_rgb888_packed_big_endian(snapshot_buf, snapshot_buf_size);
+    uint8_t *capture_buf = nullptr;
+#if EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON
+    // no crop or resize needed, let DCMIPP write straight into the NPU input buffer.
+    // Not while cascading, the networks may share NPU memory and the frame is cropped
+    // after the detector has run
+    if (!resize_required && !crop_required && !camera->is_streaming() && cascade_handle == nullptr) {
+        uint32_t nn_in_len;
+        capture_buf = ei_aton_get_input_buffer(ei_default_impulse.impulse, &nn_in_len);
+        if (nn_in_len < snapshot_buf_size) {
+            capture_buf = nullptr;
+        }
+    }
+#endif
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    if (roi_running) {
+        ei_roi_select();
+    }
+    else if (tiles_running) {
+        ei_tiles_select();
+    }
+#endif
+
+    bool isOK = camera->ei_camera_capture_rgb888_packed_big_endian(capture_buf, snapshot_buf_size);
     if (!isOK) {
         return;
     }
     camera->get_fb_ptr(&snapshot_buf);
+    image_buf = snapshot_buf;
+
+    // the frame the second stage crops from, and the model input region within it
+    ei::image_view_t frame;
+    frame.data = snapshot_buf;
+    frame.width = EI_CLASSIFIER_INPUT_WIDTH;
+    frame.height = EI_CLASSIFIER_INPUT_HEIGHT;
+    frame.format = ei::EI_IMAGE_FORMAT_RGB888;
+    int roi_x = 0, roi_y = 0;
+    int roi_width = EI_CLASSIFIER_INPUT_WIDTH, roi_height = EI_CLASSIFIER_INPUT_HEIGHT;
 
     if (resize_required || crop_required) {
+#if EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON
+        if (cascade_handle) {
+            // keep the full resolution frame, scale the centre into the NPU input buffer instead
+            uint32_t nn_in_len;
+            image_buf = ei_aton_get_input_buffer(ei_default_impulse.impulse, &nn_in_len);
+
+            frame.width = snapshot_resolution.width;
+            frame.height = snapshot_resolution.height;
+            ei::image::processing::calculate_crop_dims(frame.width, frame.height,
+                EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT, roi_width, roi_height);
+            roi_x = (frame.width - roi_width) / 2;
+            roi_y = (frame.height - roi_height) / 2;
 
-        ei::image::processing::crop_and_interpolate_rgb888(
-            snapshot_buf,
-            snapshot_resolution.width,
-            snapshot_resolution.height,
-            snapshot_buf,
-            EI_CLASSIFIER_INPUT_WIDTH,
-            EI_CLASSIFIER_INPUT_HEIGHT);
+            ei::image::processing::crop_and_resize_image(
+                snapshot_buf,
+                frame.width,
+                frame.height,
+                roi_x,
+                roi_y,
+                roi_width,
+                roi_height,
+                image_buf,
+                EI_CLASSIFIER_INPUT_WIDTH,
+                EI_CLASSIFIER_INPUT_HEIGHT,
+                3);
+            #ifdef USE_DCACHE
+            SCB_CleanDCache_by_Addr(image_buf, EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT * 3);
+            #endif
+        }
+        else
+#endif
+        {
+            ei::image::processing::crop_and_interpolate_rgb888(
+                snapshot_buf,
+                snapshot_resolution.width,
+                snapshot_resolution.height,
+                snapshot_buf,
+                EI_CLASSIFIER_INPUT_WIDTH,
+                EI_CLASSIFIER_INPUT_HEIGHT);
+        }
     }
+    frame.stride = frame.width * 3;
+
+    // consumers that understand the byte view read the frame in place,
+    // get_data stays for those that only take packed float pixels
+    ei::image_view_t image;
+    image.data = image_buf;
+    image.width = EI_CLASSIFIER_INPUT_WIDTH;
+    image.height = EI_CLASSIFIER_INPUT_HEIGHT;
+    image.stride = EI_CLASSIFIER_INPUT_WIDTH * 3;
+    image.format = ei::EI_IMAGE_FORMAT_RGB888;
 
     ei::signal_t signal;
     signal.total_length = EI_CLASSIFIER_INPUT_WIDTH * EI_CLASSIFIER_INPUT_HEIGHT;
     signal.get_data = &ei_camera_get_data;
+    signal.image = &image;
 
     // Print framebuffer as JPG during debugging
     if(debug_mode) {
@@ -215,14 +458,14 @@ void ei_run_impulse(void)
         }
 
         size_t out_size;
-        int x = encode_rgb888_signal_as_jpg(&signal, EI_CLASSIFIER_INPUT_WIDTH, EI_CLASSIFIER_INPUT_HEIGHT, jpeg_buffer, jpeg_buffer_size, &out_size);
+        int x = encode_image_view_as_jpg(&image, jpeg_buffer, jpeg_buffer_size, &out_size);
         if (x != 0) {
             ei_printf("Failed to encode frame as JPEG (%d)\n", x);
             return;
         }
 
         ei_printf("Framebuffer: ");
-        base64_encode((char*)jpeg_buffer, out_size, ei_putchar);
+        ei_transport_send(EI_TRANSPORT_FRAME_JPEG, jpeg_buffer, out_size);
         ei_printf("\r\n");
 
         if (jpeg_buffer) {
@@ -230,14 +473,86 @@ void ei_run_impulse(void)
         }
     }
 
+    ei_npu_profiler_begin_inference();
+
+    // boxes of a region of interest or tile frame are relative to the region, postprocessing
+    // (object tracking) is held back until they are in full view coordinates (for tiles, once
+    // the pass is merged). Blocks skip a NULL state
+    void **post_processing_state = ei_default_impulse.post_processing_state;
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    if (roi_running || tiles_running) {
+        ei_default_impulse.post_processing_state = nullptr;
+    }
+#endif
+
     EI_IMPULSE_ERROR ei_error = run_classifier(&signal, &result, false);
+    ei_default_impulse.post_processing_state = post_processing_state;
     if (ei_error != EI_IMPULSE_OK) {
         ei_printf("ERR: Failed to run impulse (%d)\n", ei_error);
         return;
     }
 
+    uint32_t frame_ts = 0, frame_dropped = 0;
+    if (continuous_mode) {
+        camera->get_frame_info(&frame_ts, &frame_dropped);
+    }
+
+#if EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON
+    if (pipelined) {
+        // the result is the previous frame's, there is none for the first frame
+        uint32_t ts = frame_ts, dropped = frame_dropped;
+        frame_ts = pipeline_frame_ts;
+        frame_dropped = pipeline_frame_dropped;
+        pipeline_frame_ts = ts;
+        pipeline_frame_dropped = dropped;
+
+        if (!ei_aton_pipeline_has_result()) {
+            return;
+        }
+    }
+#endif
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    if (cascade_handle) {
+        ei_error = ei_cascade_run(&frame, roi_x, roi_y, roi_width, roi_height);
+        if (ei_error != EI_IMPULSE_OK) {
+            ei_printf("ERR: Failed to run second stage (%d)\n", ei_error);
+            return;
+        }
+    }
+
+    // boxes of a region of interest frame, back to full view coordinates
+    if (roi_running && ei_roi_update() != EI_IMPULSE_OK) {
+        return;
+    }
+    // results are shown once every tile of the pass has run, the next tile is captured straight away
+    else if (tiles_running && !ei_tiles_update()) {
+        return;
+    }
+#endif
+
+    if (ei_npu_profiler_is_running()) {
+        // keep the output down to the profiling report
+        if (ei_npu_profiler_end_inference()) {
+            ei_stop_impulse();
+        }
+        return;
+    }
+
     if(state != INFERENCE_WAITING) {
-        local_display_results(&result);
+        if (cbor_results) {
+            local_send_results_cbor(&result, frame_ts, frame_dropped);
+        }
+        else {
+            local_display_results(&result);
+
+            // one more write per frame, only while debugging. CBOR records always carry it
+            if (debug_mode) {
+                ei_printf("Capture to result: %u ms, dropped frames: %u\n",
+                    (uint32_t)(ei_read_timer_ms() - frame_ts), frame_dropped);
+            }
+        }
+        result_frame_id++;
     }
 
     if (debug_mode) {
@@ -278,7 +593,7 @@ static int ei_camera_get_data(size_t offset, size_t length, float *out_ptr)
     size_t out_ptr_ix = 0;
 
     while (pixels_left != 0) {
-        out_ptr[out_ptr_ix] = (snapshot_buf[pixel_ix] << 16) + (snapshot_buf[pixel_ix + 1] << 8) + snapshot_buf[pixel_ix + 2];
+        out_ptr[out_ptr_ix] = (image_buf[pixel_ix] << 16) + (image_buf[pixel_ix + 1] << 8) + image_buf[pixel_ix + 2];
 
         // go to the next pixel
         out_ptr_ix++;
@@ -307,7 +622,7 @@ static void local_display_results(ei_impulse_result_t* result)
 
 #if EI_CLASSIFIER_OBJECT_DETECTION == 1
     ei_printf("#Object detection results:\r\n");
-    bool bb_found = result->bounding_boxes[0].value > 0;
+    bool bb_found = result->bounding_boxes_count > 0 && result->bounding_boxes[0].value > 0;
     for (size_t ix = 0; ix < result->bounding_boxes_count; ix++) {
         auto bb = result->bounding_boxes[ix];
         if (bb.value == 0) {
@@ -315,12 +630,23 @@ static void local_display_results(ei_impulse_result_t* result)
         }
         ei_printf("    %s (", bb.label);
         ei_printf_float(bb.value);
-        ei_printf(") [ x: %u, y: %u, width: %u, height: %u ]\n", bb.x, bb.y, bb.width, bb.height);
+        ei_printf(") [ x: %u, y: %u, width: %u, height: %u ]", bb.x, bb.y, bb.width, bb.height);
+        if (cascade_handle && ix < EI_CASCADE_MAX_OBJECTS && cascade_results[ix].label) {
+            ei_printf(" -> %s (", cascade_results[ix].label);
+            ei_printf_float(cascade_results[ix].value);
+            ei_printf(")");
+        }
+        ei_printf("\n");
     }
 
     if (!bb_found) {
         ei_printf("    No objects found\n");
     }
+    else if (cascade_handle) {
+        ei_printf("Second stage: ");
+        ei_printf_float((float)cascade_us/1000.0);
+        ei_printf(" ms.\n");
+    }
 
 #elif (EI_CLASSIFIER_LABEL_COUNT == 1) && (!EI_CLASSIFIER_HAS_ANOMALY)// regression
     ei_printf("#Regression results:\r\n");
@@ -353,6 +679,661 @@ static void local_display_results(ei_impulse_result_t* result)
 #endif
 }
 
+#if (EI_CLASSIFIER_OBJECT_DETECTION == 1) || (EI_CLASSIFIER_HAS_ANOMALY == 3)
+/**
+ * @brief      Open an array for a bounding box and add [label, value, x, y, width, height],
+ *             the caller may append to it and closes it
+ */
+static void local_open_box_cbor(QCBOREncodeContext *ec, const ei_impulse_result_bounding_box_t *bb)
+{
+    QCBOREncode_OpenArray(ec);
+    QCBOREncode_AddSZString(ec, bb->label);
+    QCBOREncode_AddDouble(ec, bb->value);
+    QCBOREncode_AddUInt64(ec, bb->x);
+    QCBOREncode_AddUInt64(ec, bb->y);
+    QCBOREncode_AddUInt64(ec, bb->width);
+    QCBOREncode_AddUInt64(ec, bb->height);
+}
+#endif
+
+/**
+ * @brief      Encode the result of a frame as one CBOR map and send it in one write,
+ *             a RESULT frame with the binary transport or a "Result: " base64 line:
+ *
+ *             { "frame": n, "timing": { "dsp": us, "classification": us, "anomaly": us },
+ *               "boxes": [ [label, value, x, y, width, height(, cascade label, cascade value)], ... ],
+ *               "classification": { label: value, ... }, "anomaly": value,
+ *               "visual_ad": { "mean": value, "max": value, "grid": [ box, ... ] } }
+ *
+ *             Keys are only present when the impulse produces them. Continuous mode adds
+ *             "latency" (capture to result, ms) and "dropped" (frames), a second stage
+ *             classifier adds "cascade" (us) to the timing.
+ *
+ * @param[in]  result         Result of the frame
+ * @param[in]  frame_ts       Capture time of the frame (ms), continuous mode only
+ * @param[in]  frame_dropped  Frames dropped since the previous one, continuous mode only
+ */
+static void local_send_results_cbor(ei_impulse_result_t* result, uint32_t frame_ts, uint32_t frame_dropped)
+{
+    QCBOREncodeContext ec;
+    UsefulBuf buf = { result_cbor_buf, sizeof(result_cbor_buf) };
+    UsefulBufC encoded;
+
+    QCBOREncode_Init(&ec, buf);
+    QCBOREncode_OpenMap(&ec);
+    QCBOREncode_AddUInt64ToMap(&ec, "frame", result_frame_id);
+    if (continuous_mode) {
+        QCBOREncode_AddUInt64ToMap(&ec, "latency", (uint32_t)(ei_read_timer_ms() - frame_ts));
+        QCBOREncode_AddUInt64ToMap(&ec, "dropped", frame_dropped);
+    }
+
+    QCBOREncode_OpenMapInMap(&ec, "timing");
+    QCBOREncode_AddInt64ToMap(&ec, "dsp", result->timing.dsp_us);
+    QCBOREncode_AddInt64ToMap(&ec, "classification", result->timing.classification_us);
+    QCBOREncode_AddInt64ToMap(&ec, "anomaly", result->timing.anomaly_us);
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    if (cascade_handle) {
+        QCBOREncode_AddUInt64ToMap(&ec, "cascade", cascade_us);
+    }
+#endif
+    QCBOREncode_CloseMap(&ec);
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    QCBOREncode_OpenArrayInMap(&ec, "boxes");
+    for (size_t ix = 0; ix < result->bounding_boxes_count; ix++) {
+        const ei_impulse_result_bounding_box_t *bb = &result->bounding_boxes[ix];
+        if (bb->value == 0) {
+            continue;
+        }
+        local_open_box_cbor(&ec, bb);
+        if (cascade_handle && ix < EI_CASCADE_MAX_OBJECTS && cascade_results[ix].label) {
+            QCBOREncode_AddSZString(&ec, cascade_results[ix].label);
+            QCBOREncode_AddDouble(&ec, cascade_results[ix].value);
+        }
+        QCBOREncode_CloseArray(&ec);
+    }
+    QCBOREncode_CloseArray(&ec);
+
+#elif (EI_CLASSIFIER_LABEL_COUNT == 1) && (!EI_CLASSIFIER_HAS_ANOMALY)// regression
+    QCBOREncode_AddDoubleToMap(&ec, "regression", result->classification[0].value);
+
+#elif EI_CLASSIFIER_LABEL_COUNT > 1 // if there is only one label, this is an anomaly only
+    QCBOREncode_OpenMapInMap(&ec, "classification");
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        QCBOREncode_AddDoubleToMap(&ec, result->classification[ix].label, result->classification[ix].value);
+    }
+    QCBOREncode_CloseMap(&ec);
+#endif
+#if EI_CLASSIFIER_HAS_ANOMALY == 3 // visual AD
+    QCBOREncode_OpenMapInMap(&ec, "visual_ad");
+    QCBOREncode_AddDoubleToMap(&ec, "mean", result->visual_ad_result.mean_value);
+    QCBOREncode_AddDoubleToMap(&ec, "max", result->visual_ad_result.max_value);
+    QCBOREncode_OpenArrayInMap(&ec, "grid");
+    for (uint32_t i = 0; i < result->visual_ad_count; i++) {
+        const ei_impulse_result_bounding_box_t *bb = &result->visual_ad_grid_cells[i];
+        if (bb->value == 0) {
+            continue;
+        }
+        local_open_box_cbor(&ec, bb);
+        QCBOREncode_CloseArray(&ec);
+    }
+    QCBOREncode_CloseArray(&ec);
+    QCBOREncode_CloseMap(&ec);
+#elif (EI_CLASSIFIER_HAS_ANOMALY > 0) // except for visual AD
+    QCBOREncode_AddDoubleToMap(&ec, "anomaly", result->anomaly);
+#endif
+    QCBOREncode_CloseMap(&ec);
+
+    if (QCBOREncode_Finish(&ec, &encoded) != QCBOR_SUCCESS) {
+        ei_printf("ERR: Result record of frame %u does not fit in %u bytes\n",
+            result_frame_id, (uint32_t)sizeof(result_cbor_buf));
+        return;
+    }
+
+    if (ei_transport_is_binary()) {
+        ei_transport_send(EI_TRANSPORT_FRAME_RESULT, encoded.ptr, encoded.len);
+    }
+    else {
+        ei_printf("Result: ");
+        ei_transport_send(EI_TRANSPORT_FRAME_RESULT, encoded.ptr, encoded.len);
+        ei_printf("\r\n");
+    }
+}
+
+void ei_results_set_cbor(bool enable)
+{
+    cbor_results = enable;
+}
+
+bool ei_results_is_cbor(void)
+{
+    return cbor_results;
+}
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+/**
+ * @brief      Crop every detected object from the frame and run the second stage
+ *             classifier on it, the top class is kept in cascade_results
+ *
+ * @param[in]  frame       Captured frame, full resolution when it was kept
+ * @param[in]  roi_x       Model input region within the frame
+ * @param[in]  roi_y
+ * @param[in]  roi_width
+ * @param[in]  roi_height
+ *
+ * @return     EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR ei_cascade_run(const ei::image_view_t *frame, int roi_x, int roi_y, int roi_width, int roi_height)
+{
+    const ei_impulse_t *impulse = cascade_handle->impulse;
+    const int width = impulse->input_width;
+    const int height = impulse->input_height;
+    uint64_t start_us = ei_read_timer_us();
+
+#if EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON
+    // crops are scaled straight into the input of the second network, no staging copy
+    // (normalised inputs are converted in place)
+    uint32_t nn_in_len;
+    cascade_buf = ei_aton_get_input_buffer(impulse, &nn_in_len);
+#endif
+
+    ei::image_view_t crop;
+    crop.data = cascade_buf;
+    crop.width = width;
+    crop.height = height;
+    crop.stride = width * 3;
+    crop.format = ei::EI_IMAGE_FORMAT_RGB888;
+
+    ei::signal_t signal;
+    signal.total_length = width * height;
+    signal.get_data = &ei_cascade_get_data;
+    signal.image = &crop;
+
+    for (size_t ix = 0; ix < result.bounding_boxes_count && ix < EI_CASCADE_MAX_OBJECTS; ix++) {
+        const ei_impulse_result_bounding_box_t &bb = result.bounding_boxes[ix];
+
+        cascade_results[ix].label = nullptr;
+        if (bb.value == 0 || bb.value < cascade_min_box_score) {
+            continue;
+        }
+
+        // box from model input to frame coordinates
+        int x0 = roi_x + (int)(bb.x * roi_width / EI_CLASSIFIER_INPUT_WIDTH);
+        int y0 = roi_y + (int)(bb.y * roi_height / EI_CLASSIFIER_INPUT_HEIGHT);
+        int x1 = roi_x + (int)((bb.x + bb.width) * roi_width / EI_CLASSIFIER_INPUT_WIDTH);
+        int y1 = roi_y + (int)((bb.y + bb.height) * roi_height / EI_CLASSIFIER_INPUT_HEIGHT);
+        x0 = x0 < (int)frame->width - 1 ? x0 : (int)frame->width - 1;
+        y0 = y0 < (int)frame->height - 1 ? y0 : (int)frame->height - 1;
+        x1 = x1 > (int)frame->width ? (int)frame->width : (x1 > x0 ? x1 : x0 + 1);
+        y1 = y1 > (int)frame->height ? (int)frame->height : (y1 > y0 ? y1 : y0 + 1);
+
+        ei::image::processing::crop_and_resize_image(
+            frame->data,
+            frame->width,
+            frame->height,
+            x0,
+            y0,
+            x1 - x0,
+            y1 - y0,
+            cascade_buf,
+            width,
+            height,
+            3);
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON) && defined(USE_DCACHE)
+        SCB_CleanDCache_by_Addr(cascade_buf, width * height * 3);
+#endif
+
+        EI_IMPULSE_ERROR res = run_classifier(cascade_handle, &signal, &cascade_result, false);
+        if (res != EI_IMPULSE_OK) {
+            return res;
+        }
+
+        cascade_results[ix] = { cascade_result.classification[0].label, cascade_result.classification[0].value };
+        for (size_t label = 1; label < impulse->label_count; label++) {
+            if (cascade_result.classification[label].value > cascade_results[ix].value) {
+                cascade_results[ix] = { cascade_result.classification[label].label, cascade_result.classification[label].value };
+            }
+        }
+    }
+
+    cascade_us = (uint32_t)(ei_read_timer_us() - start_us);
+
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Point the camera at the region around the objects of the previous frame,
+ *             or at the full view every roi_interval frames and when nothing was found
+ */
+static void ei_roi_select(void)
+{
+    ei_roi_t roi = roi_full_view;
+
+    if (roi_next_valid && ++roi_frames < roi_interval) {
+        roi = roi_next;
+    }
+    else {
+        roi_frames = 0;
+    }
+
+    if (!camera->set_roi(&roi.x, &roi.y, &roi.width, &roi.height)) {
+        ei_printf("ERR: Failed to set the camera region of interest\n");
+        roi = roi_full_view;
+        camera->set_roi(&roi.x, &roi.y, &roi.width, &roi.height);
+    }
+    roi_view = roi;
+}
+
+/**
+ * @brief      Map the boxes found in the region of interest to full view coordinates, run
+ *             the postprocessing held back by ei_run_impulse on them, and set the region
+ *             for the next frame around the boxes (and the predictions of the object tracker
+ *             for objects missed in this frame) with EI_ROI_MARGIN
+ *
+ * @return     EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR ei_roi_update(void)
+{
+    float x0 = 1.0f, y0 = 1.0f, x1 = 0.0f, y1 = 0.0f;
+
+    for (size_t ix = 0; ix < result.bounding_boxes_count; ix++) {
+        ei_impulse_result_bounding_box_t &bb = result.bounding_boxes[ix];
+        if (bb.value == 0) {
+            continue;
+        }
+
+        bb.x = (uint32_t)(roi_view.x * EI_CLASSIFIER_INPUT_WIDTH + bb.x * roi_view.width);
+        bb.y = (uint32_t)(roi_view.y * EI_CLASSIFIER_INPUT_HEIGHT + bb.y * roi_view.height);
+        bb.width = (uint32_t)(bb.width * roi_view.width + 0.5f);
+        bb.height = (uint32_t)(bb.height * roi_view.height + 0.5f);
+
+        x0 = std::min(x0, (float)bb.x / EI_CLASSIFIER_INPUT_WIDTH);
+        y0 = std::min(y0, (float)bb.y / EI_CLASSIFIER_INPUT_HEIGHT);
+        x1 = std::max(x1, (float)(bb.x + bb.width) / EI_CLASSIFIER_INPUT_WIDTH);
+        y1 = std::max(y1, (float)(bb.y + bb.height) / EI_CLASSIFIER_INPUT_HEIGHT);
+    }
+
+    // the tracker follows objects across frames of different regions, in full view coordinates
+    EI_IMPULSE_ERROR res = run_postprocessing(&ei_default_impulse, &result);
+    if (res != EI_IMPULSE_OK) {
+        ei_printf("ERR: Failed to run postprocessing (%d)\n", res);
+        return res;
+    }
+
+#if EI_CLASSIFIER_OBJECT_TRACKING_ENABLED == 1
+    for (uint32_t ix = 0; ix < result.postprocessed_output.object_tracking_output.open_traces_count; ix++) {
+        const ei_object_tracking_trace_t &trace = result.postprocessed_output.object_tracking_output.open_traces[ix];
+
+        x0 = std::min(x0, (float)trace.x / EI_CLASSIFIER_INPUT_WIDTH);
+        y0 = std::min(y0, (float)trace.y / EI_CLASSIFIER_INPUT_HEIGHT);
+        x1 = std::max(x1, (float)(trace.x + trace.width) / EI_CLASSIFIER_INPUT_WIDTH);
+        y1 = std::max(y1, (float)(trace.y + trace.height) / EI_CLASSIFIER_INPUT_HEIGHT);
+    }
+#endif
+
+    roi_next_valid = x1 > x0 && y1 > y0;
+    if (roi_next_valid) {
+        // the camera grows the region to the model aspect ratio and keeps it within the view
+        const float margin_x = (x1 - x0) * EI_ROI_MARGIN;
+        const float margin_y = (y1 - y0) * EI_ROI_MARGIN;
+        roi_next.x = std::max(0.0f, x0 - margin_x);
+        roi_next.y = std::max(0.0f, y0 - margin_y);
+        roi_next.width = std::min(1.0f, x1 + margin_x) - roi_next.x;
+        roi_next.height = std::min(1.0f, y1 + margin_y) - roi_next.y;
+    }
+
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Point the camera at the next tile of the pass, the full view closes the pass
+ */
+static void ei_tiles_select(void)
+{
+    ei_roi_t roi = roi_full_view;
+
+    if (tile_index < tile_cols * tile_rows) {
+        // tiles overlap by tile_overlap of their size and cover the full view
+        roi.width = 1.0f / (tile_cols - tile_overlap * (tile_cols - 1));
+        roi.height = 1.0f / (tile_rows - tile_overlap * (tile_rows - 1));
+        roi.x = (tile_index % tile_cols) * roi.width * (1.0f - tile_overlap);
+        roi.y = (tile_index / tile_cols) * roi.height * (1.0f - tile_overlap);
+    }
+
+    if (!camera->set_roi(&roi.x, &roi.y, &roi.width, &roi.height)) {
+        ei_printf("ERR: Failed to set the camera region of interest\n");
+        roi = roi_full_view;
+        camera->set_roi(&roi.x, &roi.y, &roi.width, &roi.height);
+    }
+    roi_view = roi;
+}
+
+/**
+ * @brief      Add the boxes of the current tile to the pass, in full view coordinates.
+ *             After the last tile, merge the boxes of all tiles with a per class NMS
+ *             (objects on a tile border are found by both tiles) into the result, and run
+ *             the postprocessing held back by ei_run_impulse on the merged boxes
+ *
+ * @return     true when the pass is complete and the result holds its boxes
+ */
+static bool ei_tiles_update(void)
+{
+    const ei_impulse_t *impulse = ei_default_impulse.impulse;
+
+    for (size_t ix = 0; ix < result.bounding_boxes_count; ix++) {
+        const ei_impulse_result_bounding_box_t &bb = result.bounding_boxes[ix];
+        const int class_ix = compareString(bb.label, ei_classifier_inferencing_categories, EI_CLASSIFIER_LABEL_COUNT);
+        if (bb.value == 0 || class_ix < 0) {
+            continue;
+        }
+
+        const float x = roi_view.x * EI_CLASSIFIER_INPUT_WIDTH + bb.x * roi_view.width;
+        const float y = roi_view.y * EI_CLASSIFIER_INPUT_HEIGHT + bb.y * roi_view.height;
+        tile_boxes.push_back(y);
+        tile_boxes.push_back(x);
+        tile_boxes.push_back(y + bb.height * roi_view.height);
+        tile_boxes.push_back(x + bb.width * roi_view.width);
+        tile_scores.push_back(bb.value);
+        tile_classes.push_back(class_ix);
+    }
+
+    if (++tile_index <= tile_cols * tile_rows) {
+        // the display keeps the last pass, these boxes are in tile coordinates
+        result.bounding_boxes = tile_shown_boxes;
+        result.bounding_boxes_count = tile_shown_count;
+        return false;
+    }
+    tile_index = 0;
+
+    static ei_nms_workspace_t nms_workspace = { 0 };
+    const int count = (int)tile_scores.size();
+    int selected = 0;
+    if (count > 0) {
+        tile_selected.resize(count);
+        selected = ei_nms_sorted(
+            &nms_workspace,
+            tile_boxes.data(),
+            count,
+            tile_scores.data(),
+            tile_classes.data(),
+            count,
+            0,
+            impulse->object_detection_nms.iou_threshold,
+            0.0f,
+            tile_selected.data());
+    }
+
+    tile_results.clear();
+    for (int ix = 0; ix < selected; ix++) {
+        const int box_ix = tile_selected[ix];
+        const float *box = &tile_boxes[box_ix * 4];
+        ei_impulse_result_bounding_box_t bb;
+
+        bb.label = ei_classifier_inferencing_categories[tile_classes[box_ix]];
+        bb.value = tile_scores[box_ix];
+        bb.x = (uint32_t)box[1];
+        bb.y = (uint32_t)box[0];
+        bb.width = (uint32_t)(box[3] - box[1] + 0.5f);
+        bb.height = (uint32_t)(box[2] - box[0] + 0.5f);
+        tile_results.push_back(bb);
+    }
+
+    if (selected < 0) {
+        ei_printf("ERR: Failed to merge the tiles, out of memory\n");
+    }
+
+    // fill the rest with empty boxes, like the decoders do
+    const size_t min_count = impulse->object_detection_count > 0 ? impulse->object_detection_count : 1;
+    if (tile_results.size() < min_count) {
+        tile_results.resize(min_count);
+    }
+
+    result.bounding_boxes = tile_results.data();
+    result.bounding_boxes_count = tile_results.size();
+    tile_shown_boxes = result.bounding_boxes;
+    tile_shown_count = result.bounding_boxes_count;
+
+    tile_boxes.clear();
+    tile_scores.clear();
+    tile_classes.clear();
+
+    // the tracker sees one set of full view boxes per pass
+    EI_IMPULSE_ERROR res = run_postprocessing(&ei_default_impulse, &result);
+    if (res != EI_IMPULSE_OK) {
+        ei_printf("ERR: Failed to run postprocessing (%d)\n", res);
+        return false;
+    }
+    // the tracker may hand back boxes of its own
+    tile_shown_boxes = result.bounding_boxes;
+    tile_shown_count = result.bounding_boxes_count;
+
+    return true;
+}
+
+/**
+ * @brief      Same as ei_camera_get_data, for the crop being classified
+ */
+static int ei_cascade_get_data(size_t offset, size_t length, float *out_ptr)
+{
+    const uint8_t *pixel = &cascade_buf[offset * 3];
+
+    for (size_t ix = 0; ix < length; ix++, pixel += 3) {
+        out_ptr[ix] = (pixel[0] << 16) + (pixel[1] << 8) + pixel[2];
+    }
+
+    return 0;
+}
+#endif
+
+/**
+ * @brief      Set the classifier run on every detected object, with a confidence
+ *             of at least min_box_score. Crops are taken from the full resolution
+ *             frame when the detector input is scaled down (ATON only)
+ *
+ * @param[in]  handle         Second stage impulse, RGB image classifier.
+ *                            nullptr disables the second stage
+ * @param[in]  min_box_score  Minimum confidence of a box to be classified
+ *
+ * @return     false if the impulse can't be used as a second stage
+ */
+bool ei_cascade_set_classifier(ei_impulse_handle_t *handle, float min_box_score)
+{
+    if (is_inference_running()) {
+        ei_printf("ERR: Can't change the second stage while inferencing\n");
+        return false;
+    }
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+#if EI_CLASSIFIER_INFERENCING_ENGINE != EI_CLASSIFIER_ATON
+    if (cascade_buf) {
+        ei_free(cascade_buf);
+        cascade_buf = nullptr;
+    }
+#endif
+    cascade_handle = nullptr;
+
+    if (handle == nullptr) {
+        return true;
+    }
+
+    const ei_impulse_t *impulse = handle->impulse;
+    if (impulse->nn_input_frame_size != impulse->input_width * impulse->input_height * 3) {
+        ei_printf("ERR: Second stage must be an RGB image model\n");
+        return false;
+    }
+    // results are held in an ei_impulse_result_t sized for this model's labels
+    if (impulse->label_count == 0 || impulse->label_count > EI_CLASSIFIER_LABEL_COUNT) {
+        ei_printf("ERR: Second stage must have 1 to %u labels\n", EI_CLASSIFIER_LABEL_COUNT);
+        return false;
+    }
+
+#if EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_ATON
+    // without its own network the second stage would run the detector's
+    if (!ei_aton_has_network(impulse)) {
+        ei_printf("ERR: No NPU network bound to the second stage, see ei_aton_bind_network\n");
+        return false;
+    }
+#else
+    cascade_buf = (uint8_t*)ei_malloc(impulse->input_width * impulse->input_height * 3);
+    if (cascade_buf == nullptr) {
+        ei_printf("ERR: Failed to allocate second stage buffer\n");
+        return false;
+    }
+#endif
+
+    cascade_handle = handle;
+    cascade_min_box_score = min_box_score;
+
+    return true;
+#else
+    (void)handle;
+    (void)min_box_score;
+    ei_printf("ERR: A second stage needs an object detection model\n");
+    return false;
+#endif
+}
+
+/**
+ * @brief      Get the second stage classifier
+ *
+ * @param[out] min_box_score  Minimum confidence of a box to be classified, may be nullptr
+ *
+ * @return     false if no second stage is set
+ */
+bool ei_cascade_get(float *min_box_score)
+{
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    if (cascade_handle == nullptr) {
+        return false;
+    }
+
+    if (min_box_score) {
+        *min_box_score = cascade_min_box_score;
+    }
+
+    return true;
+#else
+    (void)min_box_score;
+    return false;
+#endif
+}
+
+/**
+ * @brief      Second stage classifier built into the firmware, used by AT+CASCADE.
+ *             A build with a second model overrides this and returns its handle, after
+ *             binding its network with ATON
+ *
+ * @return     nullptr, no second stage is built in
+ */
+__attribute__((weak)) ei_impulse_handle_t *ei_cascade_builtin_classifier(void)
+{
+    return nullptr;
+}
+
+/**
+ * @brief      Capture each frame from the region around the objects found in the previous
+ *             one, so small objects are seen at up to native sensor resolution instead of
+ *             decimated with the full view. The full view is captured every full_view_interval
+ *             frames to pick up new objects. Needs a camera that outputs the model input size
+ *             as is, and single captures (no streaming)
+ *
+ * @param[in]  full_view_interval  Frames between two full views, 0 disables
+ *
+ * @return     false if region of interest capture is not available
+ */
+bool ei_roi_set_capture(uint32_t full_view_interval)
+{
+    if (is_inference_running()) {
+        ei_printf("ERR: Can't change region of interest capture while inferencing\n");
+        return false;
+    }
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    roi_interval = full_view_interval;
+
+    return true;
+#else
+    (void)full_view_interval;
+    ei_printf("ERR: Region of interest capture needs an object detection model\n");
+    return false;
+#endif
+}
+
+/**
+ * @brief      Get the region of interest capture setting
+ *
+ * @return     Frames between two full views, 0 when disabled
+ */
+uint32_t ei_roi_get_capture(void)
+{
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    return roi_interval;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief      Split the full view in cols x rows tiles overlapping by overlap of their size,
+ *             each captured at up to native sensor resolution by its own frame, followed by
+ *             a full view frame. The boxes of all frames of a pass are merged (per class NMS)
+ *             and shown once the pass is complete, so small objects are found over a wide
+ *             area without a larger model. Needs a camera that outputs the model input size
+ *             as is, and single captures (no streaming)
+ *
+ * @param[in]  cols     Tiles across, 0 disables tiled inference
+ * @param[in]  rows     Tiles down
+ * @param[in]  overlap  Overlap of neighbouring tiles, fraction of a tile (0 to 0.5)
+ *
+ * @return     false if tiled inference is not available
+ */
+bool ei_tiles_set(uint32_t cols, uint32_t rows, float overlap)
+{
+    if (is_inference_running()) {
+        ei_printf("ERR: Can't change tiled inference while inferencing\n");
+        return false;
+    }
+
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    if (cols > 0 && (rows == 0 || overlap < 0.0f || overlap > 0.5f)) {
+        ei_printf("ERR: Tiles need 1 or more rows and an overlap of 0 to 0.5\n");
+        return false;
+    }
+
+    tile_cols = cols;
+    tile_rows = cols > 0 ? rows : 0;
+    tile_overlap = overlap;
+
+    return true;
+#else
+    (void)cols;
+    (void)rows;
+    (void)overlap;
+    ei_printf("ERR: Tiled inference needs an object detection model\n");
+    return false;
+#endif
+}
+
+/**
+ * @brief      Get the tiled inference setting
+ *
+ * @param[out] cols     Tiles across, 0 when disabled
+ * @param[out] rows     Tiles down
+ * @param[out] overlap  Overlap of neighbouring tiles
+ */
+void ei_tiles_get(uint32_t *cols, uint32_t *rows, float *overlap)
+{
+#if EI_CLASSIFIER_OBJECT_DETECTION == 1
+    *cols = tile_cols;
+    *rows = tile_rows;
+    *overlap = tile_overlap;
+#else
+    *cols = 0;
+    *rows = 0;
+    *overlap = 0.0f;
+#endif
+}
+
 static int compareString(const char *str, const char *array[], int size)
 {
     for (int i = 0; i < size; i++) {
@@ -44,4 +44,27 @@ extern void ei_run_impulse(void);
 extern void ei_stop_impulse(void);
 extern bool is_inference_running(void);
 
+/* Second stage classifier, run on the crop of every detected object. With the ATON
+ * engine its network is bound first: ei_aton_bind_network(handle->impulse, &NN_Instance_name) */
+class ei_impulse_handle_t;
+extern bool ei_cascade_set_classifier(ei_impulse_handle_t *handle, float min_box_score = 0.5f);
+extern bool ei_cascade_get(float *min_box_score);
+/* Second stage offered by AT+CASCADE, weak, nullptr unless the firmware is built with one */
+extern ei_impulse_handle_t *ei_cascade_builtin_classifier(void);
+
+/* Region of interest capture: frames are cropped by the camera around the previous detections,
+ * with a full view every full_view_interval frames (0 disables) */
+extern bool ei_roi_set_capture(uint32_t full_view_interval);
+extern uint32_t ei_roi_get_capture(void);
+
+/* Tiled inference: the full view is split in cols x rows overlapping tiles (0 disables),
+ * one tile per frame, the boxes of a pass are merged with a cross-tile NMS */
+extern bool ei_tiles_set(uint32_t cols, uint32_t rows, float overlap = 0.2f);
+extern void ei_tiles_get(uint32_t *cols, uint32_t *rows, float *overlap);
+
+/* Results as one CBOR record per frame, sent through the transport (RESULT frames, or a base64
+ * line starting with "Result: "), instead of the printed predictions */
+extern void ei_results_set_cbor(bool enable);
+extern bool ei_results_is_cbor(void);
+
 #endif /* EI_RUN_IMPULSE_H */
@@ -35,14 +35,24 @@
 /* Include ----------------------------------------------------------------- */
 #include "ei_camera.h"
 #include "firmware-sdk/at_base64_lib.h"
+#include "firmware-sdk/ei_device_interface.h"
+#include "firmware-sdk/ei_transport_lib.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include <cmath>
 #include "app_config.h"
 
 static uint8_t *global_camera_buffer;
 
-extern "C" void CAM_ei_PipeInitNn(int width, int height);
+extern "C" int CAM_ei_PipeIsSupported(int width, int height);
+extern "C" int CAM_ei_PipeInitNn(int width, int height);
+extern "C" int CAM_ei_PipeSetRoi(float *x, float *y, float *width, float *height);
+extern "C" void CAM_ei_PackFrame(uint8_t *frame);
 extern "C" uint8_t *CAM_ei_capture_frame(void);
+extern "C" uint8_t *CAM_ei_capture_frame_to(uint8_t *dst, uint32_t size);
+extern "C" void app_nn_pipe_start(void);
+extern "C" void app_nn_pipe_stop(void);
+extern "C" uint8_t *app_nn_pipe_get_frame(void);
+extern "C" void app_nn_pipe_get_frame_info(uint32_t *timestamp_ms, uint32_t *dropped);
 
 ei_device_snapshot_resolutions_t EiSTCamera::resolutions[] = {
         {96, 96},
@@ -57,22 +67,20 @@ ei_device_snapshot_resolutions_t EiSTCamera::resolutions[] = {
 
 
 /**
- * @brief 
- * 
- * @param width 
- * @param height 
- * @return true 
- * @return false 
+ * @brief Configure the DCMIPP to output the closest supported resolution
+ *
+ * @param width
+ * @param height
+ * @return true
+ * @return false
  */
 bool EiSTCamera::init(uint16_t width, uint16_t height)
 {
     camera_found = true;
 
-    /** @todo This breaks, somehow this function can only be called once */
-    // CAM_ei_PipeInitNn(width, height);
-
-    this->width = width;
-    this->height = height;
+    if (!set_resolution(search_resolution(width, height))) {
+        return false;
+    }
 
     global_camera_buffer = CAM_ei_capture_frame();
 
@@ -87,9 +95,44 @@ bool EiSTCamera::init(uint16_t width, uint16_t height)
  */
 bool EiSTCamera::deinit(void)
 {
+    stop_stream();
+
+    return true;
+}
+
+/**
+ * @brief Start continuous capture, frames are captured in the background
+ * while the previous one is processed
+ *
+ * @return true
+ * @return false
+ */
+bool EiSTCamera::start_stream(void)
+{
+    if (streaming) {
+        return true;
+    }
+
+    app_nn_pipe_start();
+    streaming = true;
+
     return true;
 }
 
+/**
+ * @brief Stop continuous capture and go back to single snapshots
+ *
+ */
+void EiSTCamera::stop_stream(void)
+{
+    if (!streaming) {
+        return;
+    }
+
+    app_nn_pipe_stop();
+    streaming = false;
+}
+
 /**
  * @brief 
  * 
@@ -103,16 +146,60 @@ void EiSTCamera::get_resolutions(ei_device_snapshot_resolutions_t **res, uint8_t
 }
 
 /**
- * @brief 
- * 
- * @param res 
- * @return true 
- * @return false 
+ * @brief Reconfigure PIPE2 (crop, decimation and downsize) so the DCMIPP outputs frames
+ * of the given resolution, continuous capture is restarted around the change
+ *
+ * @param res
+ * @return true
+ * @return false if the pipe can't output this resolution
  */
 bool EiSTCamera::set_resolution(const ei_device_snapshot_resolutions_t res)
 {
-    this->width = res.width;
-    this->height = res.height;
+    if (pipe_configured && !roi_active && res.width == this->width && res.height == this->height) {
+        return true;
+    }
+
+    bool was_streaming = streaming;
+    stop_stream();
+
+    bool ok = CAM_ei_PipeInitNn(res.width, res.height) == 0;
+    if (ok) {
+        this->width = res.width;
+        this->height = res.height;
+        pipe_configured = true;
+        roi_active = false;
+    }
+
+    if (was_streaming) {
+        start_stream();
+    }
+
+    return ok;
+}
+
+/**
+ * @brief Capture a region of interest of the field of view at the current resolution,
+ * given as a fraction (0 to 1) of the full view. The region is grown to the output aspect
+ * ratio and to no less than native sensor resolution, the region actually captured is
+ * written back. Not while streaming, the crop has to change between two frames.
+ *
+ * @param x
+ * @param y
+ * @param width
+ * @param height
+ * @return true
+ * @return false
+ */
+bool EiSTCamera::set_roi(float *x, float *y, float *width, float *height)
+{
+    if (streaming || !pipe_configured) {
+        return false;
+    }
+
+    if (CAM_ei_PipeSetRoi(x, y, width, height) != 0) {
+        return false;
+    }
+    roi_active = *width < 1.0f || *height < 1.0f;
 
     return true;
 }
@@ -123,14 +210,48 @@ bool EiSTCamera::get_fb_ptr(uint8_t** fb_ptr)
     return true;
 }
 
+/**
+ * @brief Capture a RGB888 frame
+ *
+ * @param image Optional destination, if set the frame is written there directly instead of the camera buffer
+ * (ignored while streaming)
+ * @param image_size Size of image, must hold a full frame at the current resolution
+ * @return true
+ * @return false
+ */
 bool EiSTCamera::ei_camera_capture_rgb888_packed_big_endian(
     uint8_t *image,
     uint32_t image_size)
 {
-    global_camera_buffer = CAM_ei_capture_frame();
+    // continuous capture owns the buffers, take the latest completed frame
+    if (streaming) {
+        global_camera_buffer = app_nn_pipe_get_frame();
+        CAM_ei_PackFrame(global_camera_buffer);
+    }
+    else if (image != nullptr) {
+        if (image_size < (uint32_t)(this->width * this->height * 3)) {
+            return false;
+        }
+        global_camera_buffer = CAM_ei_capture_frame_to(image, image_size);
+    }
+    else {
+        global_camera_buffer = CAM_ei_capture_frame();
+    }
+
     return 1;
 }
 
+/**
+ * @brief Get capture information of the last frame returned by the camera
+ *
+ * @param timestamp_ms Time at which the frame landed in memory (ms timer)
+ * @param dropped Frames dropped by the continuous capture since boot
+ */
+void EiSTCamera::get_frame_info(uint32_t *timestamp_ms, uint32_t *dropped)
+{
+    app_nn_pipe_get_frame_info(timestamp_ms, dropped);
+}
+
 /**
  * @brief 
  * 
@@ -153,30 +274,36 @@ EiCamera* EiCamera::get_camera(void)
 }
 
 /**
- * @brief 
- * 
- * @param required_width 
- * @param required_height 
- * @return ei_device_snapshot_resolutions_t 
+ * @brief The DCMIPP scales in hardware, so any size it can output is used as is.
+ * Otherwise fall back to the smallest listed resolution covering the request
+ * (or the largest one the pipe can output)
+ *
+ * @param required_width
+ * @param required_height
+ * @return ei_device_snapshot_resolutions_t
  */
 ei_device_snapshot_resolutions_t EiSTCamera::search_resolution(uint32_t required_width, uint32_t required_height)
 {
-    ei_device_snapshot_resolutions_t res;
-    // uint16_t max_width;
-    // uint16_t max_height;
-
-    // camera_get_max_res(&max_width, &max_height);
-
-    // if ((required_width <= max_width) && (required_height <= max_height)) {
-    //     res.height = required_height;
-    //     res.width = required_width;
-    // }
-    // else {
-    //     res.height = max_height;
-    //     res.width = max_width;
-    // }
-    res.height = NN_WIDTH;
-    res.width = NN_HEIGHT;
+    ei_device_snapshot_resolutions_t res = EiSTCamera::resolutions[0];
+    const size_t res_num = sizeof(EiSTCamera::resolutions) / sizeof(ei_device_snapshot_resolutions_t);
+
+    if (CAM_ei_PipeIsSupported(required_width, required_height)) {
+        res.width = required_width;
+        res.height = required_height;
+        return res;
+    }
+
+    for (size_t ix = 0; ix < res_num; ix++) {
+        const ei_device_snapshot_resolutions_t &cur = EiSTCamera::resolutions[ix];
+
+        if (!CAM_ei_PipeIsSupported(cur.width, cur.height)) {
+            continue;
+        }
+        res = cur;
+        if (cur.width >= required_width && cur.height >= required_height) {
+            break;
+        }
+    }
 
     return res;
 }
@@ -195,6 +322,11 @@ bool ei_camera_read_encode_send_sample_buffer(const char *input, size_t length)
     const int buffer_size = 513;
     uint8_t* buffer = (uint8_t*)input;
 
+    if (ei_transport_is_binary()) {
+        ei_transport_send(EI_TRANSPORT_FRAME_SAMPLE, input, length);
+        return true;
+    }
+
     size_t output_size_check = floor(buffer_size / 3 * 4);
     size_t mod = buffer_size % 3;
     output_size_check += mod;
@@ -218,9 +350,7 @@ bool ei_camera_read_encode_send_sample_buffer(const char *input, size_t length)
         uart_print_to_console(buffer_out, to_send);
 #else
         // comms_send(buffer_out, to_send, 1000);
-        for(int i = 0; i < to_send; i++) {
-            ei_putchar(buffer_out[i]);
-        }
+        ei_write(buffer_out, to_send);
 #endif
 
         address += bytes_to_read;
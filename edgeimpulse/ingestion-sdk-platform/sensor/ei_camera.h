@@ -47,6 +47,9 @@ private:
     static ei_device_snapshot_resolutions_t resolutions[];
 
     bool camera_found;
+    bool streaming = false;
+    bool pipe_configured = false;
+    bool roi_active = false;
     uint16_t width;
     uint16_t height;
 
@@ -64,6 +67,13 @@ public:
         uint32_t image_size) override;
 
     bool get_fb_ptr(uint8_t** fb_ptr) override;
+
+    bool set_roi(float *x, float *y, float *width, float *height);
+
+    bool start_stream(void);
+    void stop_stream(void);
+    bool is_streaming(void) {return streaming;};
+    void get_frame_info(uint32_t *timestamp_ms, uint32_t *dropped);
 };
 
 
@@ -36,10 +36,12 @@
 #include "firmware-sdk/at-server/ei_at_command_set.h"
 #include "firmware-sdk/ei_device_lib.h"
 #include "firmware-sdk/ei_image_lib.h"
+#include "firmware-sdk/ei_transport_lib.h"
 #include "model-parameters/model_metadata.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 
 #include "inference/ei_run_impulse.h"
+#include "inference/ei_npu_profiler.h"
 
 EiDeviceStm32n6 *pei_device;
 
@@ -64,6 +66,7 @@ static bool at_run_impulse_debug(const char **argv, const int argc);
 static bool at_run_nn_normal(void);
 static bool at_run_nn_normal_cont(void);
 static bool at_run_impulse_debug(const char **argv, const int argc);
+static bool at_profile(const char **argv, const int argc);
 
 static bool at_get_mgmt_settings(void);
 static bool at_set_mgmt_settings(const char **argv, const int argc);
@@ -72,6 +75,17 @@ static bool at_get_snapshot(void);
 static bool at_take_snapshot(const char **argv, const int argc);
 static bool at_snapshot_stream(const char **argv, const int argc);
 
+static bool at_get_transport(void);
+static bool at_set_transport(const char **argv, const int argc);
+static bool at_get_result_format(void);
+static bool at_set_result_format(const char **argv, const int argc);
+static bool at_get_cascade(void);
+static bool at_set_cascade(const char **argv, const int argc);
+static bool at_get_roi(void);
+static bool at_set_roi(const char **argv, const int argc);
+static bool at_get_tiles(void);
+static bool at_set_tiles(const char **argv, const int argc);
+
 static inline bool check_args_num(const int &required, const int &received);
 
 /* Public function definition */
@@ -93,6 +107,7 @@ ATServer *ei_at_init(EiDeviceStm32n6 *ei_device)
     at->register_command(AT_RUNIMPULSE, AT_RUNIMPULSE_HELP_TEXT, at_run_nn_normal, nullptr, nullptr, nullptr);
     at->register_command(AT_RUNIMPULSEDEBUG, AT_RUNIMPULSEDEBUG_HELP_TEXT, nullptr, nullptr, at_run_impulse_debug, AT_RUNIMPULSEDEBUG_ARGS);
     at->register_command(AT_RUNIMPULSECONT, AT_RUNIMPULSECONT_HELP_TEXT, at_run_nn_normal_cont, nullptr, nullptr, nullptr);
+    at->register_command(AT_PROFILE, AT_PROFILE_HELP_TEXT, nullptr, nullptr, at_profile, AT_PROFILE_ARGS);
     at->register_command(AT_READBUFFER, AT_READBUFFER_HELP_TEXT, nullptr, nullptr, at_read_buffer, AT_READBUFFER_ARGS);
     at->register_command(AT_MGMTSETTINGS, AT_MGMTSETTINGS_HELP_TEXT, nullptr, at_get_mgmt_settings, at_set_mgmt_settings, AT_MGMTSETTINGS_ARGS);
     at->register_command(AT_UPLOADSETTINGS, AT_UPLOADSETTINGS_HELP_TEXT, nullptr, at_get_upload_settings, at_set_upload_settings, AT_UPLOADSETTINGS_ARGS);
@@ -100,6 +115,11 @@ ATServer *ei_at_init(EiDeviceStm32n6 *ei_device)
     at->register_command(AT_UPLOADHOST, AT_UPLOADHOST_HELP_TEXT, nullptr, at_get_upload_host, at_set_upload_host, AT_UPLOADHOST_ARGS);
     at->register_command(AT_SNAPSHOT, AT_SNAPSHOT_HELP_TEXT, nullptr, at_get_snapshot, at_take_snapshot, AT_SNAPSHOT_ARGS);
     at->register_command(AT_SNAPSHOTSTREAM, AT_SNAPSHOTSTREAM_HELP_TEXT, nullptr, nullptr, at_snapshot_stream, AT_SNAPSHOTSTREAM_ARGS);
+    at->register_command(AT_TRANSPORT, AT_TRANSPORT_HELP_TEXT, nullptr, at_get_transport, at_set_transport, AT_TRANSPORT_ARGS);
+    at->register_command(AT_RESULTFORMAT, AT_RESULTFORMAT_HELP_TEXT, nullptr, at_get_result_format, at_set_result_format, AT_RESULTFORMAT_ARGS);
+    at->register_command(AT_CASCADE, AT_CASCADE_HELP_TEXT, nullptr, at_get_cascade, at_set_cascade, AT_CASCADE_ARGS);
+    at->register_command(AT_ROI, AT_ROI_HELP_TEXT, nullptr, at_get_roi, at_set_roi, AT_ROI_ARGS);
+    at->register_command(AT_TILES, AT_TILES_HELP_TEXT, nullptr, at_get_tiles, at_set_tiles, AT_TILES_ARGS);
 
     return at;
 }
@@ -284,6 +304,38 @@ static bool at_run_nn_normal_cont(void)
     return (is_inference_running());
 }
 
+/**
+ * @brief Handler for PROFILE
+ *
+ * @param argv
+ * @param argc
+ * @return
+ */
+static bool at_profile(const char **argv, const int argc)
+{
+    uint32_t inferences = 10;
+
+    if (argc > 0) {
+        inferences = (uint32_t)atoi(argv[0]);
+        if (inferences == 0) {
+            ei_printf("ERR: Invalid number of inferences\n");
+            return true;
+        }
+    }
+
+    if (ei_npu_profiler_start(inferences) == false) {
+        return true;
+    }
+
+    ei_start_impulse(true, false, false);
+
+    if (is_inference_running() == false) {
+        ei_npu_profiler_stop();
+    }
+
+    return (is_inference_running());
+}
+
 /**
  *
  * @param argv
@@ -667,6 +719,176 @@ static bool at_snapshot_stream(const char **argv, const int argc)
     return true;
 }
 
+static bool at_get_transport(void)
+{
+    ei_printf("%s\r\n", ei_transport_is_binary() ? "BINARY" : "BASE64");
+
+    return true;
+}
+
+static bool at_set_transport(const char **argv, const int argc)
+{
+    if (check_args_num(1, argc) == false) {
+        return true;
+    }
+
+    if (strcmp(argv[0], "BINARY") == 0) {
+        ei_transport_set_mode(EI_TRANSPORT_BINARY);
+    }
+    else if (strcmp(argv[0], "BASE64") == 0) {
+        ei_transport_set_mode(EI_TRANSPORT_BASE64);
+    }
+    else {
+        ei_printf("ERR: Unknown transport, expected " AT_TRANSPORT_ARGS "\r\n");
+        return true;
+    }
+
+    ei_printf("OK\r\n");
+
+    return true;
+}
+
+static bool at_get_result_format(void)
+{
+    ei_printf("%s\r\n", ei_results_is_cbor() ? "CBOR" : "TEXT");
+
+    return true;
+}
+
+static bool at_set_result_format(const char **argv, const int argc)
+{
+    if (check_args_num(1, argc) == false) {
+        return true;
+    }
+
+    if (strcmp(argv[0], "CBOR") == 0) {
+        ei_results_set_cbor(true);
+    }
+    else if (strcmp(argv[0], "TEXT") == 0) {
+        ei_results_set_cbor(false);
+    }
+    else {
+        ei_printf("ERR: Unknown result format, expected " AT_RESULTFORMAT_ARGS "\r\n");
+        return true;
+    }
+
+    ei_printf("OK\r\n");
+
+    return true;
+}
+
+static bool at_get_cascade(void)
+{
+    float min_box_score;
+
+    if (ei_cascade_get(&min_box_score)) {
+        ei_printf_float(min_box_score);
+        ei_printf("\r\n");
+    }
+    else {
+        ei_printf("OFF\r\n");
+    }
+
+    return true;
+}
+
+static bool at_set_cascade(const char **argv, const int argc)
+{
+    if (check_args_num(1, argc) == false) {
+        return true;
+    }
+
+    if (strcmp(argv[0], "OFF") == 0) {
+        ei_cascade_set_classifier(nullptr);
+        ei_printf("OK\r\n");
+        return true;
+    }
+
+    float min_box_score = (float)atof(argv[0]);
+    if (min_box_score < 0.0f || min_box_score > 1.0f) {
+        ei_printf("ERR: Invalid score, expected 0 to 1\r\n");
+        return true;
+    }
+
+    ei_impulse_handle_t *handle = ei_cascade_builtin_classifier();
+    if (handle == nullptr) {
+        ei_printf("ERR: Firmware built without a second stage classifier\r\n");
+        return true;
+    }
+
+    if (ei_cascade_set_classifier(handle, min_box_score) == false) {
+        return true;
+    }
+
+    ei_printf("OK\r\n");
+
+    return true;
+}
+
+static bool at_get_roi(void)
+{
+    ei_printf("%lu\r\n", (unsigned long)ei_roi_get_capture());
+
+    return true;
+}
+
+static bool at_set_roi(const char **argv, const int argc)
+{
+    if (check_args_num(1, argc) == false) {
+        return true;
+    }
+
+    if (ei_roi_set_capture((uint32_t)atoi(argv[0])) == false) {
+        return true;
+    }
+
+    ei_printf("OK\r\n");
+
+    return true;
+}
+
+static bool at_get_tiles(void)
+{
+    uint32_t cols, rows;
+    float overlap;
+
+    ei_tiles_get(&cols, &rows, &overlap);
+    ei_printf("%lu,%lu,", (unsigned long)cols, (unsigned long)rows);
+    ei_printf_float(overlap);
+    ei_printf("\r\n");
+
+    return true;
+}
+
+static bool at_set_tiles(const char **argv, const int argc)
+{
+    uint32_t cols, rows = 0;
+    float overlap = 0.2f;
+
+    if (check_args_num(1, argc) == false) {
+        return true;
+    }
+
+    cols = (uint32_t)atoi(argv[0]);
+    if (cols > 0 && check_args_num(2, argc) == false) {
+        return true;
+    }
+    if (argc > 1) {
+        rows = (uint32_t)atoi(argv[1]);
+    }
+    if (argc > 2) {
+        overlap = (float)atof(argv[2]);
+    }
+
+    if (ei_tiles_set(cols, rows, overlap) == false) {
+        return true;
+    }
+
+    ei_printf("OK\r\n");
+
+    return true;
+}
+
 /**
  *
  * @param required
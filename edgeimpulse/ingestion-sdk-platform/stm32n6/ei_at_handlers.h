@@ -38,6 +38,30 @@
 #include "firmware-sdk/at-server/ei_at_server.h"
 #include "ingestion-sdk-platform/stm32n6/ei_device_st_stm32n6.h"
 
+#define AT_PROFILE              "PROFILE"
+#define AT_PROFILE_ARGS         "[INFERENCES]"
+#define AT_PROFILE_HELP_TEXT    "Run continuous inference and print NPU per-epoch timings after INFERENCES runs (default 10)"
+
+#define AT_TRANSPORT            "TRANSPORT"
+#define AT_TRANSPORT_ARGS       "BASE64|BINARY"
+#define AT_TRANSPORT_HELP_TEXT  "Get or set how snapshots, sample buffers and debug framebuffers are sent (BINARY: CRC checked frames)"
+
+#define AT_RESULTFORMAT             "RESULTFORMAT"
+#define AT_RESULTFORMAT_ARGS        "TEXT|CBOR"
+#define AT_RESULTFORMAT_HELP_TEXT   "Get or set the inference result output (CBOR: one record per frame, sent through the transport)"
+
+#define AT_CASCADE              "CASCADE"
+#define AT_CASCADE_ARGS         "MIN_BOX_SCORE|OFF"
+#define AT_CASCADE_HELP_TEXT    "Get or set the second stage classifier built into the firmware, run on detected objects with a confidence of at least MIN_BOX_SCORE"
+
+#define AT_ROI                  "ROI"
+#define AT_ROI_ARGS             "FULL_VIEW_INTERVAL"
+#define AT_ROI_HELP_TEXT        "Get or set region of interest capture, the camera follows the detected objects with a full view every FULL_VIEW_INTERVAL frames (0 disables)"
+
+#define AT_TILES                "TILES"
+#define AT_TILES_ARGS           "COLS,ROWS,[OVERLAP]"
+#define AT_TILES_HELP_TEXT      "Get or set tiled inference, the view is split in COLS x ROWS tiles overlapping by OVERLAP (default 0.2) of their size (COLS 0 disables)"
+
 ATServer *ei_at_init(EiDeviceStm32n6 *device);
 
 #endif /* AT_HANDLERS_H_ */
@@ -37,6 +37,7 @@
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
 #include "edge-impulse-sdk/dsp/ei_utils.h"
 #include "stm32n6xx_hal.h"
+#include "mem_placement.h"
 
 /* Private variables ------------------------------------------------------- */
 
@@ -168,8 +169,8 @@ bool EiDeviceStm32n6::get_sensor_list(const ei_device_sensor_t **p_sensor_list,
  */
 EiDeviceInfo* EiDeviceInfo::get_device(void)
 {
-    // __attribute__((aligned(32), section(".bss.device_info")))  static EiDeviceRAM<262144, 4> memory(sizeof(EiConfig));
-    static EiDeviceRAM<262144, 4> memory(sizeof(EiConfig));
+    // placed by Gcc/mem_planner.py, see Inc/mem_placement.h
+    EI_DEVICE_RAM_SECTION static EiDeviceRAM<262144, 4> memory(sizeof(EiConfig));
     static EiDeviceStm32n6 dev(&memory);
 
     return &dev;
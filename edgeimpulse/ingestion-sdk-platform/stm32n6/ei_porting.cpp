@@ -34,48 +34,434 @@
 
 /* Include ----------------------------------------------------------------- */
 #include "main.h"
+#include "tx_api.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include "firmware-sdk/ei_device_interface.h"
 #include <cstring>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdint>
 
+/* Constants --------------------------------------------------------------- */
+/* Size of the UART TX ring, a power of two */
+#ifndef EI_UART_TX_RING_SIZE
+#define EI_UART_TX_RING_SIZE    8192
+#endif
+
+/* Size of the UART TX ring for output from interrupts, a power of two */
+#ifndef EI_UART_TX_ISR_RING_SIZE
+#define EI_UART_TX_ISR_RING_SIZE    512
+#endif
+
+/* Size of the UART RX ring, a power of two */
+#ifndef EI_UART_RX_RING_SIZE
+#define EI_UART_RX_RING_SIZE    1024
+#endif
+
+/* Longest line ei_printf formats on the stack, longer ones go through the heap */
+#define EI_PRINTF_BUFFER_SIZE   256
+
+#define EI_DCACHE_LINE          32
+
 extern UART_HandleTypeDef huart1;
 
+/* Private variables ------------------------------------------------------- */
+/* Written by the threads at tx_head, drained by UART DMA from tx_tail. Both are free
+ * running counters, tx_dma_len is the size of the transfer in flight (0: idle) */
+__attribute__((aligned(EI_DCACHE_LINE)))
+static uint8_t tx_ring[EI_UART_TX_RING_SIZE];
+static volatile uint32_t tx_head;
+static volatile uint32_t tx_tail;
+static volatile uint32_t tx_dma_len;
+
+static TX_MUTEX tx_lock;
+/* posted on every completed transfer, writers wait on it for ring space */
+static TX_SEMAPHORE tx_space;
+static bool tx_ring_ready = false;
+
+/* Output from contexts that can't wait for ring space (interrupts), sent by the DMA
+ * between runs of tx_ring. Bytes that don't fit are dropped and counted */
+__attribute__((aligned(EI_DCACHE_LINE)))
+static uint8_t tx_isr_ring[EI_UART_TX_ISR_RING_SIZE];
+static volatile uint32_t tx_isr_head;
+static volatile uint32_t tx_isr_tail;
+static volatile uint32_t tx_isr_dropped;
+/* the transfer in flight is from tx_isr_ring */
+static volatile bool tx_dma_isr;
+
+/* Filled by the UART receive interrupt at rx_head, read by ei_getchar from rx_tail.
+ * Bytes arriving while the ring is full are dropped */
+static uint8_t rx_ring[EI_UART_RX_RING_SIZE];
+static volatile uint32_t rx_head;
+static volatile uint32_t rx_tail;
+static uint8_t rx_byte;
+
+/* posted on every received byte, the AT loop waits on it while idle */
+static TX_SEMAPHORE rx_data;
+static bool rx_ring_ready = false;
+
+static_assert((EI_UART_TX_RING_SIZE & (EI_UART_TX_RING_SIZE - 1)) == 0, "EI_UART_TX_RING_SIZE must be a power of two");
+static_assert((EI_UART_TX_ISR_RING_SIZE & (EI_UART_TX_ISR_RING_SIZE - 1)) == 0, "EI_UART_TX_ISR_RING_SIZE must be a power of two");
+static_assert((EI_UART_RX_RING_SIZE & (EI_UART_RX_RING_SIZE - 1)) == 0, "EI_UART_RX_RING_SIZE must be a power of two");
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief The ring needs a thread that can block, interrupts and early boot bypass it
+ */
+static inline bool tx_ring_usable(void)
+{
+    return tx_ring_ready && __get_IPSR() == 0 && tx_thread_identify() != TX_NULL;
+}
+
+/**
+ * @brief Start DMA on the next contiguous run of the rings, if idle.
+ * Called from the writers with interrupts masked and from the TX complete interrupt.
+ */
+static void tx_ring_kick(void)
+{
+    uint8_t *ring;
+    uint32_t size;
+    uint32_t head;
+    volatile uint32_t *tail;
+
+    if (tx_dma_len != 0) {
+        return;
+    }
+
+    if (tx_head != tx_tail) {
+        ring = tx_ring;
+        size = EI_UART_TX_RING_SIZE;
+        head = tx_head;
+        tail = &tx_tail;
+        tx_dma_isr = false;
+    }
+    else if (tx_isr_head != tx_isr_tail) {
+        ring = tx_isr_ring;
+        size = EI_UART_TX_ISR_RING_SIZE;
+        head = tx_isr_head;
+        tail = &tx_isr_tail;
+        tx_dma_isr = true;
+    }
+    else {
+        return;
+    }
+
+    uint32_t offset = *tail & (size - 1);
+    uint32_t len = head - *tail;
+
+    if (len > size - offset) {
+        len = size - offset;
+    }
+
+#if defined(USE_DCACHE)
+    uint32_t clean_start = offset & ~(EI_DCACHE_LINE - 1);
+    SCB_CleanDCache_by_Addr((uint32_t *)&ring[clean_start], offset + len - clean_start);
+#endif
+
+    tx_dma_len = len;
+    if (HAL_UART_Transmit_DMA(&huart1, &ring[offset], len) != HAL_OK) {
+        /* drop the run rather than stall the writers forever */
+        *tail += len;
+        tx_dma_len = 0;
+    }
+}
+
+/**
+ * @brief Copy data into the ring, waiting for the DMA to make room when it is full
+ */
+static void tx_ring_write(const uint8_t *data, size_t length)
+{
+    tx_mutex_get(&tx_lock, TX_WAIT_FOREVER);
+
+    while (length > 0) {
+        uint32_t used = tx_head - tx_tail;
+
+        if (used == EI_UART_TX_RING_SIZE) {
+            tx_semaphore_get(&tx_space, TX_WAIT_FOREVER);
+            continue;
+        }
+
+        uint32_t offset = tx_head & (EI_UART_TX_RING_SIZE - 1);
+        uint32_t chunk = EI_UART_TX_RING_SIZE - used;
+
+        if (chunk > EI_UART_TX_RING_SIZE - offset) {
+            chunk = EI_UART_TX_RING_SIZE - offset;
+        }
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(&tx_ring[offset], data, chunk);
+        data += chunk;
+        length -= chunk;
+
+        UINT old_posture = tx_interrupt_control(TX_INT_DISABLE);
+        tx_head += chunk;
+        tx_ring_kick();
+        tx_interrupt_control(old_posture);
+    }
+
+    tx_mutex_put(&tx_lock);
+}
+
+/**
+ * @brief Copy data into the interrupt ring without waiting, with interrupts masked so
+ * nested interrupts and the TX complete interrupt see a consistent ring
+ */
+static void tx_isr_ring_write(const uint8_t *data, size_t length)
+{
+    UINT old_posture = tx_interrupt_control(TX_INT_DISABLE);
+
+    uint32_t space = EI_UART_TX_ISR_RING_SIZE - (tx_isr_head - tx_isr_tail);
+    if (length > space) {
+        tx_isr_dropped += length - space;
+        length = space;
+    }
+
+    for (size_t ix = 0; ix < length; ix++) {
+        tx_isr_ring[(tx_isr_head + ix) & (EI_UART_TX_ISR_RING_SIZE - 1)] = data[ix];
+    }
+    tx_isr_head += length;
+    tx_ring_kick();
+
+    tx_interrupt_control(old_posture);
+}
+
+/**
+ * @brief Receive the next byte into rx_byte, from the interrupt
+ */
+static void rx_ring_arm(void)
+{
+    HAL_UART_Receive_IT(&huart1, &rx_byte, 1);
+}
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief Set up the UART TX ring. Output before this is sent with blocking transfers,
+ * output from interrupts after it goes through a small ring of its own.
+ */
+void ei_uart_tx_init(void)
+{
+    if (tx_ring_ready) {
+        return;
+    }
+
+    tx_head = 0;
+    tx_tail = 0;
+    tx_isr_head = 0;
+    tx_isr_tail = 0;
+    tx_dma_len = 0;
+    tx_mutex_create(&tx_lock, (CHAR *)"ei_uart_tx", TX_INHERIT);
+    tx_semaphore_create(&tx_space, (CHAR *)"ei_uart_tx_space", 0);
+    tx_ring_ready = true;
+}
+
+/**
+ * @brief Set up the UART RX ring and start receiving from the interrupt. ei_getchar
+ * polls the UART before this.
+ */
+void ei_uart_rx_init(void)
+{
+    if (rx_ring_ready) {
+        return;
+    }
+
+    rx_head = 0;
+    rx_tail = 0;
+    tx_semaphore_create(&rx_data, (CHAR *)"ei_uart_rx", 0);
+    rx_ring_ready = true;
+    rx_ring_arm();
+}
 
+/**
+ * @brief Wait for received data
+ *
+ * @param timeout_ms Longest wait (one tick per ms), 0 to return straight away,
+ * UINT32_MAX to wait forever
+ * @return true if the RX ring holds data
+ */
+bool ei_uart_rx_wait(uint32_t timeout_ms)
+{
+    if (!rx_ring_ready) {
+        return false;
+    }
+
+    while (rx_head == rx_tail) {
+        /* the semaphore may hold a put for bytes already read, check the ring again */
+        if (tx_semaphore_get(&rx_data, (timeout_ms == UINT32_MAX) ? TX_WAIT_FOREVER : timeout_ms) != TX_SUCCESS) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Wait until everything written so far is on the wire
+ */
+void ei_uart_tx_flush(void)
+{
+    if (!tx_ring_usable()) {
+        return;
+    }
+
+    tx_mutex_get(&tx_lock, TX_WAIT_FOREVER);
+    while (tx_head != tx_tail || tx_isr_head != tx_isr_tail) {
+        tx_semaphore_get(&tx_space, TX_WAIT_FOREVER);
+    }
+    tx_mutex_put(&tx_lock);
+}
+
+/**
+ * @brief Queue data for the serial port, returns once it is in the TX ring
+ */
+void ei_write(const void *data, size_t length)
+{
+    if (length == 0) {
+        return;
+    }
+
+    if (!tx_ring_ready) {
+        HAL_UART_Transmit(&huart1, (const uint8_t *)data, length, HAL_MAX_DELAY);
+        return;
+    }
+
+    /* a blocking transfer would fail with HAL_BUSY while the DMA is sending */
+    if (!tx_ring_usable()) {
+        tx_isr_ring_write((const uint8_t *)data, length);
+        return;
+    }
+
+    tx_ring_write((const uint8_t *)data, length);
+}
+
+/**
+ * @brief Release the run the DMA was sending and start the next one, from the interrupt.
+ * A run ended by an error is dropped rather than resent.
+ */
+static void tx_ring_done(void)
+{
+    if (tx_dma_isr) {
+        tx_isr_tail += tx_dma_len;
+    }
+    else {
+        tx_tail += tx_dma_len;
+    }
+    tx_dma_len = 0;
+    tx_ring_kick();
+    tx_semaphore_ceiling_put(&tx_space, 1);
+}
+
+extern "C" void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart != &huart1) {
+        return;
+    }
+
+    tx_ring_done();
+}
+
+extern "C" void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart != &huart1) {
+        return;
+    }
+
+    if (rx_head - rx_tail < EI_UART_RX_RING_SIZE) {
+        rx_ring[rx_head & (EI_UART_RX_RING_SIZE - 1)] = rx_byte;
+        rx_head++;
+    }
+    rx_ring_arm();
+    tx_semaphore_ceiling_put(&rx_data, 1);
+}
+
+extern "C" void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    /* an overrun aborts the reception, pick it up again */
+    if (huart == &huart1 && rx_ring_ready && huart->RxState == HAL_UART_STATE_READY) {
+        rx_ring_arm();
+    }
+
+    /* a DMA error ends the transfer without TX complete, the writers would wait forever */
+    if (huart == &huart1 && tx_dma_len != 0 && huart->gState == HAL_UART_STATE_READY) {
+        tx_ring_done();
+    }
+}
+
+/**
+ * @brief Next received character, 0 when there is none
+ */
 char ei_getchar(void)
 {
-    HAL_StatusTypeDef status;
     char data[1] = {0};
 
-    status = HAL_UART_Receive(&huart1, (uint8_t *)data, 1, 0);
+    if (!rx_ring_ready) {
+        HAL_UART_Receive(&huart1, (uint8_t *)data, 1, 0);
+        return data[0];
+    }
+
+    if (rx_head != rx_tail) {
+        data[0] = rx_ring[rx_tail & (EI_UART_RX_RING_SIZE - 1)];
+        rx_tail++;
+    }
 
     return data[0];
 }
 
+void ei_putchar(char c)
+{
+    ei_write(&c, 1);
+}
+
 void ei_printf(const char *format, ...) {
 
-    extern UART_HandleTypeDef huart1;
-    char buffer[256] = {0};
+    char buffer[EI_PRINTF_BUFFER_SIZE];
     int length;
     va_list myargs;
     va_start(myargs, format);
     length = vsnprintf(buffer, sizeof(buffer), format, myargs);
     va_end(myargs);
 
-    if (length > 0){
-        //comms_send((uint8_t*)buffer, length, 100);
-        HAL_UART_Transmit(&huart1, (uint8_t*)buffer, length, 10);
+    if (length <= 0) {
+        return;
+    }
+
+    if (length < (int)sizeof(buffer)) {
+        ei_write(buffer, length);
+        return;
+    }
+
+    /* line did not fit, format it again on the heap instead of truncating */
+    char *long_buffer = (char *)ei_malloc(length + 1);
+    if (long_buffer == NULL) {
+        ei_write(buffer, sizeof(buffer) - 1);
+        return;
     }
-    
+
+    va_start(myargs, format);
+    vsnprintf(long_buffer, length + 1, format, myargs);
+    va_end(myargs);
+
+    ei_write(long_buffer, length);
+    ei_free(long_buffer);
 }
 
 void ei_uart_baudrate_switch(int32_t baudrate)
 {
+    /* do not cut the output queued at the old rate */
+    ei_uart_tx_flush();
+    while (huart1.gState != HAL_UART_STATE_READY);
+
     huart1.Init.BaudRate = baudrate;
 
     HAL_UART_DeInit(&huart1);
     HAL_UART_Init(&huart1);
     HAL_UARTEx_SetRxFifoThreshold(&huart1, UART_RXFIFO_THRESHOLD_1_8);
     HAL_UARTEx_EnableFifoMode(&huart1);
-}
\ No newline at end of file
+
+    if (rx_ring_ready) {
+        rx_ring_arm();
+    }
+}
@@ -4,6 +4,7 @@ CXX_SOURCES += edgeimpulse/edge-impulse-sdk/porting/stm32-cubeai/ei_classifier_p
 CXX_SOURCES += edgeimpulse/ingestion-sdk-platform/sensor/ei_camera.cpp
 CXX_SOURCES += $(wildcard edgeimpulse/ingestion-sdk-platform/stm32n6/*.cpp)
 CXX_SOURCES += edgeimpulse/firmware-sdk/at_base64_lib.cpp
+CXX_SOURCES += edgeimpulse/firmware-sdk/ei_transport_lib.cpp
 CXX_SOURCES += edgeimpulse/firmware-sdk/jpeg/JPEGENC.cpp
 CXX_SOURCES += edgeimpulse/firmware-sdk/ei_device_lib.cpp
 CXX_SOURCES += edgeimpulse/firmware-sdk/ei_image_lib.cpp
@@ -21,6 +22,11 @@ CC_SOURCES = $(wildcard edgeimpulse/edge-impulse-sdk/tensorflow/lite/kernels/*.c
 	$(wildcard edgeimpulse/edge-impulse-sdk/tensorflow/lite/micro/memory_planner/*.cc) \
 	$(wildcard edgeimpulse/edge-impulse-sdk/tensorflow/lite/core/api/*.cc) \
 
+# QCBOR encoder, for the CBOR result records
+C_SOURCES += edgeimpulse/firmware-sdk/QCBOR/src/UsefulBuf.c
+C_SOURCES += edgeimpulse/firmware-sdk/QCBOR/src/ieee754.c
+C_SOURCES += edgeimpulse/firmware-sdk/QCBOR/src/qcbor_encode.c
+
 CXX_INCLUDES += -Iedgeimpulse/edge-impulse-sdk/classifier
 CXX_INCLUDES += -Iedgeimpulse/edge-impulse-sdk/classifier/inference_engines
 CXX_INCLUDES += -Iedgeimpulse